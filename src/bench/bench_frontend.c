@@ -0,0 +1,403 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/arena.h"
+#include "../common/diag.h"
+#include "../common/incremental.h"
+#include "../common/lexer.h"
+#include "../common/parser.h"
+#include "../common/symbols.h"
+#include "../common/type_check.h"
+#include "gen_java.h"
+
+typedef struct {
+    const char *name;
+    GenConfig cfg;
+} BenchCase;
+
+typedef struct {
+    size_t bytes;
+    size_t tokens;
+    size_t nodes;
+    size_t arena_reserved;
+    size_t arena_used;
+    double lex_sec;
+    double parse_sec;
+    double check_sec;
+} BenchResult;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static size_t count_nodes(const Parser *ps) {
+    size_t n = 0;
+    for (int i = 0; i < AST_KIND_COUNT; i++) {
+        n += ps->node_counts[i];
+    }
+    return n;
+}
+
+static int run_case(const BenchCase *bc, int iters, BenchResult *out) {
+    size_t len = 0;
+    char *src = gen_java_source(&bc->cfg, &len);
+    if (!src) {
+        fprintf(stderr, "bench: out of memory generating '%s'\n", bc->name);
+        return 0;
+    }
+    memset(out, 0, sizeof(*out));
+    out->bytes = len;
+
+    Diag diag;
+    diag_init(&diag, bc->name, src, len);
+
+    double start = now_sec();
+    for (int i = 0; i < iters; i++) {
+        Lexer lx;
+        lexer_init(&lx, src, len, &diag);
+        while (lexer_next(&lx).type != TOK_EOF) {
+        }
+        out->tokens = lx.token_count;
+        lexer_free(&lx);
+    }
+    out->lex_sec = (now_sec() - start) / iters;
+
+    for (int i = 0; i < iters && !diag.had_error; i++) {
+        Arena arena;
+        arena_init(&arena);
+        Parser ps;
+        double t0 = now_sec();
+        parser_init(&ps, src, len, &diag, &arena);
+        Ast *unit = parse_compilation_unit(&ps);
+        double t1 = now_sec();
+        type_check_comp_unit(unit, &diag);
+        double t2 = now_sec();
+        out->parse_sec += t1 - t0;
+        out->check_sec += t2 - t1;
+        out->nodes = count_nodes(&ps);
+        parser_free(&ps);
+        ArenaStats as;
+        arena_stats(&arena, &as);
+        out->arena_reserved = as.reserved;
+        out->arena_used = as.used;
+        arena_free(&arena);
+    }
+    out->parse_sec /= iters;
+    out->check_sec /= iters;
+
+    int ok = !diag.had_error;
+    diag_free(&diag);
+    free(src);
+    if (!ok) {
+        fprintf(stderr, "bench: generated source for '%s' failed to compile\n", bc->name);
+    }
+    return ok;
+}
+
+typedef struct {
+    int files;
+    size_t bytes;
+    size_t symbols;
+    double index_sec;
+    double check_sec;
+} ProjectResult;
+
+/*
+ * A multi-file project the way a driver compiles it: a declarations pass
+ * over every file fills one symbol index, then each file is parsed and
+ * checked against it, so calls and types resolve across files.
+ */
+static int run_project(const GenConfig *cfg, int files, ProjectResult *out) {
+    memset(out, 0, sizeof(*out));
+    out->files = files;
+    char **srcs = (char **)calloc((size_t)files, sizeof(char *));
+    size_t *lens = (size_t *)calloc((size_t)files, sizeof(size_t));
+    char (*paths)[24] = (char (*)[24])calloc((size_t)files, sizeof(*paths));
+    Diag *diags = (Diag *)calloc((size_t)files, sizeof(Diag));
+    int ok = srcs && lens && paths && diags;
+    for (int i = 0; ok && i < files; i++) {
+        srcs[i] = gen_java_project_file(cfg, i, files, &lens[i]);
+        ok = srcs[i] != NULL;
+        if (ok) {
+            snprintf(paths[i], sizeof(paths[i]), "C%d.java", i);
+            diag_init(&diags[i], paths[i], srcs[i], lens[i]);
+            out->bytes += lens[i];
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "bench: out of memory generating a %d-file project\n", files);
+    }
+
+    SymbolIndex ix;
+    symbols_init(&ix);
+    Arena decl_arena;
+    arena_init(&decl_arena);
+    double t0 = now_sec();
+    for (int i = 0; ok && i < files; i++) {
+        ok = symbols_scan_file(&ix, paths[i], srcs[i], lens[i], &decl_arena, &diags[i]);
+    }
+    double t1 = now_sec();
+    if (ok && !ix.main_class) {
+        fprintf(stderr, "bench: main method not found in the %d-file project\n", files);
+        ok = 0;
+    }
+    out->symbols = ix.count;
+
+    TypeCheckOptions opts = {0};
+    opts.threads = 1;
+    opts.symbols = &ix;
+    for (int i = 0; ok && i < files; i++) {
+        Arena arena;
+        arena_init(&arena);
+        Parser ps;
+        parser_init(&ps, srcs[i], lens[i], &diags[i], &arena);
+        Ast *unit = parse_compilation_unit(&ps);
+        parser_free(&ps);
+        ok = unit && type_check_comp_unit_opts(unit, &diags[i], &opts) && !diags[i].had_error;
+        arena_free(&arena);
+    }
+    double t2 = now_sec();
+    out->index_sec = t1 - t0;
+    out->check_sec = t2 - t1;
+    if (!ok && srcs && lens && paths && diags) {
+        fprintf(stderr, "bench: the generated %d-file project failed to compile\n", files);
+    }
+
+    symbols_free(&ix);
+    arena_free(&decl_arena);
+    for (int i = 0; srcs && diags && i < files; i++) {
+        if (srcs[i]) diag_free(&diags[i]);
+        free(srcs[i]);
+    }
+    free(srcs);
+    free(lens);
+    free(paths);
+    free(diags);
+    return ok;
+}
+
+typedef struct {
+    size_t bytes;
+    size_t members;
+    size_t reparsed;
+    double full_sec;
+    double cold_sec;
+    double edit_sec;
+} IncResult;
+
+/*
+ * Watch mode on one large file: a full parse and check, the first
+ * incremental update, and then updates that each edit one method body in
+ * the middle of the file.
+ */
+static int run_incremental(const GenConfig *cfg, int iters, IncResult *out) {
+    memset(out, 0, sizeof(*out));
+    size_t len = 0;
+    char *src = gen_java_project_file(cfg, 0, 1, &len);
+    if (!src) {
+        fprintf(stderr, "bench: out of memory generating the watched file\n");
+        return 0;
+    }
+    out->bytes = len;
+    /* The digit after the middle method's "v1 = v0 + " is what the edits toggle. */
+    char *edit = strstr(src + len / 2, "int v1 = v0 + ");
+    if (!edit) {
+        free(src);
+        return 0;
+    }
+    edit += strlen("int v1 = v0 + ");
+
+    Diag diag;
+    diag_init(&diag, "Watched.java", src, len);
+    Arena arena;
+    arena_init(&arena);
+    Parser ps;
+    double t0 = now_sec();
+    parser_init(&ps, src, len, &diag, &arena);
+    Ast *unit = parse_compilation_unit(&ps);
+    parser_free(&ps);
+    type_check_comp_unit(unit, &diag);
+    out->full_sec = now_sec() - t0;
+    arena_free(&arena);
+
+    Incremental inc;
+    incremental_init(&inc, NULL);
+    t0 = now_sec();
+    int ok = !diag.had_error && incremental_update(&inc, "Watched.java", src, len, NULL, &diag);
+    out->cold_sec = now_sec() - t0;
+    out->members = inc.stats.members;
+
+    for (int i = 0; ok && i < iters; i++) {
+        *edit = *edit == '1' ? '2' : '1';
+        t0 = now_sec();
+        ok = incremental_update(&inc, "Watched.java", src, len, NULL, &diag);
+        out->edit_sec += now_sec() - t0;
+        out->reparsed = inc.stats.reparsed;
+    }
+    out->edit_sec /= iters;
+    if (!ok) {
+        fprintf(stderr, "bench: the watched file failed to compile\n");
+    }
+    incremental_free(&inc);
+    diag_free(&diag);
+    free(src);
+    return ok;
+}
+
+static double per_sec(double amount, double sec) {
+    return sec > 0 ? amount / sec : 0.0;
+}
+
+static void print_result(FILE *out, const BenchCase *bc, const BenchResult *r, int last) {
+    double mb = (double)r->bytes / (1024.0 * 1024.0);
+    fprintf(out, "    {\"name\": \"%s\", \"bytes\": %zu, \"locals\": %d, \"expr_depth\": %d, "
+                 "\"comment_pct\": %d, \"string_pct\": %d,\n",
+            bc->name, r->bytes, bc->cfg.locals, bc->cfg.expr_depth, bc->cfg.comment_pct, bc->cfg.string_pct);
+    fprintf(out, "     \"tokens\": %zu, \"nodes\": %zu, \"arena_reserved\": %zu, \"arena_used\": %zu,\n",
+            r->tokens, r->nodes, r->arena_reserved, r->arena_used);
+    fprintf(out, "     \"lex\": {\"sec\": %.6f, \"mb_per_sec\": %.2f, \"tokens_per_sec\": %.0f},\n",
+            r->lex_sec, per_sec(mb, r->lex_sec), per_sec((double)r->tokens, r->lex_sec));
+    fprintf(out, "     \"parse\": {\"sec\": %.6f, \"mb_per_sec\": %.2f, \"nodes_per_sec\": %.0f},\n",
+            r->parse_sec, per_sec(mb, r->parse_sec), per_sec((double)r->nodes, r->parse_sec));
+    fprintf(out, "     \"type_check\": {\"sec\": %.6f, \"mb_per_sec\": %.2f, \"nodes_per_sec\": %.0f}}%s\n",
+            r->check_sec, per_sec(mb, r->check_sec), per_sec((double)r->nodes, r->check_sec), last ? "" : ",");
+}
+
+static void print_project(FILE *out, const ProjectResult *r, int last) {
+    fprintf(out, "    {\"files\": %d, \"bytes\": %zu, \"symbols\": %zu, \"index_sec\": %.6f, \"check_sec\": %.6f, "
+                 "\"total_sec\": %.6f}%s\n",
+            r->files, r->bytes, r->symbols, r->index_sec, r->check_sec, r->index_sec + r->check_sec, last ? "" : ",");
+}
+
+static void print_incremental(FILE *out, const IncResult *r) {
+    fprintf(out, "  \"incremental\": {\"bytes\": %zu, \"members\": %zu, \"reparsed_per_edit\": %zu, "
+                 "\"full_sec\": %.6f, \"cold_update_sec\": %.6f, \"edit_update_sec\": %.6f}\n",
+            r->bytes, r->members, r->reparsed, r->full_sec, r->cold_sec, r->edit_sec);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench_frontend [-o out.json] [-n iterations] [--dump case] [--no-projects]\n");
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    const char *dump = NULL;
+    int iters = 5;
+    int projects = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dump = argv[++i];
+        } else if (strcmp(argv[i], "--no-projects") == 0) {
+            projects = 0;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (iters < 1) {
+        iters = 1;
+    }
+
+    BenchCase cases[8];
+    int n = 0;
+    for (int i = 0; i < 8; i++) {
+        gen_config_default(&cases[i].cfg);
+    }
+    cases[n++].name = "baseline";
+    cases[n].name = "large_file";
+    cases[n++].cfg.target_bytes = 8u << 20;
+    cases[n].name = "many_locals";
+    cases[n++].cfg.locals = 200;
+    cases[n].name = "deep_expr";
+    cases[n++].cfg.expr_depth = 8;
+    cases[n].name = "comment_heavy";
+    cases[n++].cfg.comment_pct = 80;
+    cases[n].name = "string_heavy";
+    cases[n++].cfg.string_pct = 80;
+
+    if (dump) {
+        for (int i = 0; i < n; i++) {
+            if (strcmp(cases[i].name, dump) == 0) {
+                size_t len = 0;
+                char *src = gen_java_source(&cases[i].cfg, &len);
+                if (!src) return 1;
+                fwrite(src, 1, len, stdout);
+                free(src);
+                return 0;
+            }
+        }
+        fprintf(stderr, "bench: unknown case '%s'\n", dump);
+        return 2;
+    }
+
+    FILE *out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            fprintf(stderr, "bench: cannot open '%s'\n", out_path);
+            return 1;
+        }
+    }
+
+    int ok = 1;
+    fprintf(out, "{\n  \"iterations\": %d,\n  \"cases\": [\n", iters);
+    for (int i = 0; i < n; i++) {
+        BenchResult r;
+        if (!run_case(&cases[i], iters, &r)) {
+            ok = 0;
+            memset(&r, 0, sizeof(r));
+        }
+        print_result(out, &cases[i], &r, i == n - 1);
+        if (out != stdout) {
+            fprintf(stderr, "%-14s %8.2f MB/s lex  %8.2f MB/s parse  %8.2f MB/s check\n", cases[i].name,
+                    per_sec((double)r.bytes / (1024.0 * 1024.0), r.lex_sec),
+                    per_sec((double)r.bytes / (1024.0 * 1024.0), r.parse_sec),
+                    per_sec((double)r.bytes / (1024.0 * 1024.0), r.check_sec));
+        }
+    }
+    fprintf(out, "  ],\n  \"projects\": [\n");
+    static const int project_files[] = {500, 2000, 8000};
+    int project_count = projects ? (int)(sizeof(project_files) / sizeof(project_files[0])) : 0;
+    GenConfig project_cfg;
+    gen_config_default(&project_cfg);
+    project_cfg.target_bytes = 2048;
+    for (int i = 0; i < project_count; i++) {
+        ProjectResult r;
+        if (!run_project(&project_cfg, project_files[i], &r)) {
+            ok = 0;
+        }
+        print_project(out, &r, i == project_count - 1);
+        if (out != stdout) {
+            fprintf(stderr, "project %-6d %8.3f s index  %8.3f s check  %8.3f s total\n", r.files, r.index_sec,
+                    r.check_sec, r.index_sec + r.check_sec);
+        }
+    }
+    fprintf(out, "  ],\n");
+    GenConfig watched_cfg;
+    gen_config_default(&watched_cfg);
+    watched_cfg.target_bytes = 2u << 20;
+    IncResult inc;
+    if (!run_incremental(&watched_cfg, iters, &inc)) {
+        ok = 0;
+    }
+    print_incremental(out, &inc);
+    if (out != stdout) {
+        fprintf(stderr, "incremental    %8.3f s full  %8.3f s cold update  %8.3f s one-method edit (%zu members)\n",
+                inc.full_sec, inc.cold_sec, inc.edit_sec, inc.members);
+    }
+    fprintf(out, "}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return ok ? 0 : 1;
+}
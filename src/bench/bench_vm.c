@@ -0,0 +1,423 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "gen_java.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define BENCH_HAVE_PERF 1
+#endif
+#endif
+
+/*
+ * VM benchmark: compiles each workload under --dir with our javac, then
+ * runs it with our java and measures the whole process from exec. The
+ * workloads' loop counts are fixed, so ops are known here up front.
+ * The startup workload is generated rather than read from --dir.
+ */
+typedef struct {
+    const char *name;
+    const char *source;
+    const char *main_class;
+    double ops;
+    const char *op;
+    int generated_classes; /* > 0: gen_java_startup with this many classes */
+} VmCase;
+
+#define STARTUP_CLASSES 64
+
+static const VmCase vm_cases[] = {
+    {"int_arith", "Arith.java", "Arith", 20000000, "loop iteration", 0},
+    {"println", "Println.java", "Println", 200000, "line", 0},
+    {"alloc_churn", "Alloc.java", "Alloc", 5000000, "allocation", 0},
+    {"calls", "Calls.java", "Calls", 2692537, "call", 0},
+    {"startup", "Startup.java", "Startup", STARTUP_CLASSES + 1, "class loaded", STARTUP_CLASSES},
+};
+
+#define VM_CASE_COUNT (sizeof(vm_cases) / sizeof(vm_cases[0]))
+
+typedef struct {
+    int status;
+    double wall_sec;
+    double first_output_sec; /* -1 when nothing was printed */
+    long max_rss_kb;
+    long long instructions;  /* -1 when counters are unavailable */
+    size_t output_bytes;
+} RunResult;
+
+typedef struct {
+    int runs;
+    double wall_min;
+    double wall_median;
+    double first_output_median;
+    long max_rss_kb;
+    long long instructions;
+    size_t output_bytes;
+} CaseResult;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Counts user-space instructions of pid and its threads from its exec on. */
+static int perf_open(pid_t pid) {
+#ifdef BENCH_HAVE_PERF
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+static long long perf_read(int fd) {
+    long long count = -1;
+    if (fd < 0) {
+        return -1;
+    }
+    if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) {
+        count = -1;
+    }
+    close(fd);
+    return count;
+}
+
+/*
+ * Runs argv in dir with stdout captured. The child waits on a pipe until
+ * the counter is attached, and the clock starts when it is released.
+ */
+static int run_command(char *const argv[], const char *dir, RunResult *out) {
+    memset(out, 0, sizeof(*out));
+    out->first_output_sec = -1;
+    out->instructions = -1;
+    int out_pipe[2];
+    int go_pipe[2];
+    if (pipe(out_pipe) != 0) {
+        return 0;
+    }
+    if (pipe(go_pipe) != 0) {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return 0;
+    }
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(go_pipe[0]);
+        close(go_pipe[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        char c;
+        close(out_pipe[0]);
+        close(go_pipe[1]);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        close(out_pipe[1]);
+        while (read(go_pipe[0], &c, 1) > 0) {
+        }
+        close(go_pipe[0]);
+        if (chdir(dir) != 0) {
+            _exit(127);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(out_pipe[1]);
+    close(go_pipe[0]);
+
+    int perf_fd = perf_open(pid);
+    double start = now_sec();
+    close(go_pipe[1]);
+
+    char buf[65536];
+    for (;;) {
+        ssize_t n = read(out_pipe[0], buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        if (out->output_bytes == 0) {
+            out->first_output_sec = now_sec() - start;
+        }
+        out->output_bytes += (size_t)n;
+    }
+    close(out_pipe[0]);
+
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    wait4(pid, &status, 0, &ru);
+    out->wall_sec = now_sec() - start;
+    out->max_rss_kb = ru.ru_maxrss;
+    out->instructions = perf_read(perf_fd);
+    out->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return 1;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int copy_file(const char *from, const char *to) {
+    FILE *in = fopen(from, "rb");
+    if (!in) {
+        return 0;
+    }
+    FILE *out = fopen(to, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    char buf[8192];
+    size_t n;
+    int ok = 1;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n, out) != n) {
+            ok = 0;
+            break;
+        }
+    }
+    fclose(in);
+    return fclose(out) == 0 && ok;
+}
+
+static int write_startup(int classes, const char *to) {
+    size_t len = 0;
+    char *src = gen_java_startup(classes, &len);
+    if (!src) {
+        return 0;
+    }
+    FILE *out = fopen(to, "wb");
+    int ok = out && fwrite(src, 1, len, out) == len;
+    if (out && fclose(out) != 0) {
+        ok = 0;
+    }
+    free(src);
+    return ok;
+}
+
+/* Removes dir and the files javac left in it. */
+static void remove_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d) {
+        struct dirent *e;
+        char path[PATH_MAX];
+        while ((e = readdir(d)) != NULL) {
+            if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) {
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+            unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+static int run_case(const VmCase *vc, const char *src_dir, const char *javac, const char *java, int iters,
+                    CaseResult *out) {
+    memset(out, 0, sizeof(*out));
+    out->first_output_median = -1;
+    out->instructions = -1;
+    char work[] = "/tmp/bench_vm.XXXXXX";
+    if (!mkdtemp(work)) {
+        fprintf(stderr, "bench_vm: cannot create a work directory\n");
+        return 0;
+    }
+    char from[PATH_MAX];
+    char to[PATH_MAX];
+    if (snprintf(from, sizeof(from), "%s/%s", src_dir, vc->source) >= (int)sizeof(from) ||
+        snprintf(to, sizeof(to), "%s/%s", work, vc->source) >= (int)sizeof(to) ||
+        !(vc->generated_classes > 0 ? write_startup(vc->generated_classes, to) : copy_file(from, to))) {
+        fprintf(stderr, "bench_vm: cannot write '%s'\n", to);
+        remove_dir(work);
+        return 0;
+    }
+
+    RunResult r;
+    char *compile[] = {(char *)javac, (char *)vc->source, NULL};
+    if (!run_command(compile, work, &r) || r.status != 0) {
+        fprintf(stderr, "bench_vm: %s failed to compile %s\n", javac, vc->source);
+        remove_dir(work);
+        return 0;
+    }
+
+    double *wall = (double *)calloc((size_t)iters, sizeof(double));
+    double *first = (double *)calloc((size_t)iters, sizeof(double));
+    long long *insns = (long long *)calloc((size_t)iters, sizeof(long long));
+    int ok = wall && first && insns;
+    char *run[] = {(char *)java, (char *)vc->main_class, NULL};
+    for (int i = 0; ok && i < iters; i++) {
+        if (!run_command(run, work, &r) || r.status != 0) {
+            fprintf(stderr, "bench_vm: %s %s exited with status %d\n", java, vc->main_class, r.status);
+            ok = 0;
+            break;
+        }
+        wall[i] = r.wall_sec;
+        first[i] = r.first_output_sec;
+        insns[i] = r.instructions;
+        if (r.max_rss_kb > out->max_rss_kb) {
+            out->max_rss_kb = r.max_rss_kb;
+        }
+        out->output_bytes = r.output_bytes;
+    }
+    if (ok) {
+        qsort(wall, (size_t)iters, sizeof(double), cmp_double);
+        qsort(first, (size_t)iters, sizeof(double), cmp_double);
+        qsort(insns, (size_t)iters, sizeof(long long), cmp_ll);
+        out->runs = iters;
+        out->wall_min = wall[0];
+        out->wall_median = wall[iters / 2];
+        out->first_output_median = first[iters / 2];
+        out->instructions = insns[0] < 0 ? -1 : insns[iters / 2];
+    }
+    free(wall);
+    free(first);
+    free(insns);
+    remove_dir(work);
+    return ok;
+}
+
+static double per_sec(double amount, double sec) {
+    return sec > 0 ? amount / sec : 0.0;
+}
+
+static void print_result(FILE *out, const VmCase *vc, const CaseResult *r, int ok, int last) {
+    fprintf(out, "    {\"name\": \"%s\", \"source\": \"%s\", \"ok\": %s, \"runs\": %d, \"ops\": %.0f, \"op\": \"%s\",\n",
+            vc->name, vc->source, ok ? "true" : "false", r->runs, vc->ops, vc->op);
+    fprintf(out, "     \"ops_per_sec\": %.0f, \"wall_sec\": {\"min\": %.6f, \"median\": %.6f},\n",
+            per_sec(vc->ops, r->wall_median), r->wall_min, r->wall_median);
+    fprintf(out, "     \"first_output_sec\": ");
+    if (r->first_output_median < 0) {
+        fprintf(out, "null");
+    } else {
+        fprintf(out, "%.6f", r->first_output_median);
+    }
+    fprintf(out, ", \"peak_rss_kb\": %ld, \"output_bytes\": %zu, \"instructions\": ", r->max_rss_kb, r->output_bytes);
+    if (r->instructions < 0) {
+        fprintf(out, "null");
+    } else {
+        fprintf(out, "%lld", r->instructions);
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+/* Paths with a slash are made absolute, since commands run in a work directory. */
+static const char *resolve_path(const char *path, char *buf) {
+    if (!strchr(path, '/')) {
+        return path;
+    }
+    return realpath(path, buf) ? buf : path;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: bench_vm [-o out.json] [-n iterations] [--java path] [--javac path] [--dir workloads]\n");
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    const char *java = "./java";
+    const char *javac = "./javac";
+    const char *dir = "src/bench/vm";
+    int iters = 5;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--java") == 0 && i + 1 < argc) {
+            java = argv[++i];
+        } else if (strcmp(argv[i], "--javac") == 0 && i + 1 < argc) {
+            javac = argv[++i];
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (iters < 1) {
+        iters = 1;
+    }
+
+    char java_buf[PATH_MAX];
+    char javac_buf[PATH_MAX];
+    char dir_buf[PATH_MAX];
+    java = resolve_path(java, java_buf);
+    javac = resolve_path(javac, javac_buf);
+    if (realpath(dir, dir_buf)) {
+        dir = dir_buf;
+    }
+
+    FILE *out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            fprintf(stderr, "bench_vm: cannot open '%s'\n", out_path);
+            return 1;
+        }
+    }
+
+    int have_perf = 0;
+#ifdef BENCH_HAVE_PERF
+    int probe = perf_open(0);
+    if (probe >= 0) {
+        have_perf = 1;
+        close(probe);
+    }
+#endif
+
+    int ok = 1;
+    fprintf(out, "{\n  \"iterations\": %d,\n  \"perf_counters\": %s,\n  \"cases\": [\n", iters,
+            have_perf ? "true" : "false");
+    for (size_t i = 0; i < VM_CASE_COUNT; i++) {
+        const VmCase *vc = &vm_cases[i];
+        CaseResult r;
+        int case_ok = run_case(vc, dir, javac, java, iters, &r);
+        ok &= case_ok;
+        print_result(out, vc, &r, case_ok, i == VM_CASE_COUNT - 1);
+        if (out != stdout) {
+            fprintf(stderr, "%-12s %12.0f ops/s  %8.3f ms to first output  %8ld KB peak RSS\n", vc->name,
+                    per_sec(vc->ops, r.wall_median), r.first_output_median * 1e3, r.max_rss_kb);
+        }
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+#include "gen_java.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The type checker keeps at most 256 locals per method, one of them args. */
+#define GEN_MAX_LOCALS 200
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    unsigned rng;
+    int failed; /* an append ran out of memory; the output is truncated */
+} GenBuf;
+
+static int buf_reserve(GenBuf *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) {
+        return 1;
+    }
+    size_t cap = b->cap ? b->cap : 4096;
+    while (b->len + extra + 1 > cap) {
+        cap *= 2;
+    }
+    char *data = (char *)realloc(b->data, cap);
+    if (!data) {
+        return 0;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 1;
+}
+
+static void buf_printf(GenBuf *b, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (b->failed || n < 0 || !buf_reserve(b, (size_t)n)) {
+        b->failed = 1;
+        return;
+    }
+    va_start(args, fmt);
+    vsnprintf(b->data + b->len, (size_t)n + 1, fmt, args);
+    va_end(args);
+    b->len += (size_t)n;
+}
+
+static unsigned gen_rand(GenBuf *b) {
+    unsigned x = b->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    b->rng = x;
+    return x;
+}
+
+static int gen_pct(GenBuf *b, int pct) {
+    return (int)(gen_rand(b) % 100) < pct;
+}
+
+static void gen_int_expr(GenBuf *b, int depth, int locals) {
+    if (depth <= 0) {
+        if (gen_rand(b) % 2) {
+            buf_printf(b, "v%d", (int)(gen_rand(b) % (unsigned)locals));
+        } else {
+            buf_printf(b, "%u", gen_rand(b) % 1000);
+        }
+        return;
+    }
+    static const char ops[] = {'+', '-', '*', '/', '%'};
+    char op = ops[gen_rand(b) % sizeof(ops)];
+    buf_printf(b, "(");
+    gen_int_expr(b, depth - 1, locals);
+    /* Keep divisors non-zero so the generated program is also runnable. */
+    if (op == '/' || op == '%') {
+        buf_printf(b, " %c %u)", op, 1 + gen_rand(b) % 97);
+    } else {
+        buf_printf(b, " %c ", op);
+        gen_int_expr(b, depth - 1, locals);
+        buf_printf(b, ")");
+    }
+}
+
+static void gen_string_lit(GenBuf *b) {
+    static const char *words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta"};
+    int n = 1 + (int)(gen_rand(b) % 4);
+    buf_printf(b, "\"");
+    for (int i = 0; i < n; i++) {
+        buf_printf(b, "%s%s", i ? " " : "", words[gen_rand(b) % 8]);
+    }
+    buf_printf(b, "\"");
+}
+
+static void gen_comment(GenBuf *b) {
+    if (gen_rand(b) % 2) {
+        buf_printf(b, "        // generated comment %u\n", gen_rand(b) % 10000);
+    } else {
+        buf_printf(b, "        /* generated block comment %u\n         * spanning two lines */\n", gen_rand(b) % 10000);
+    }
+}
+
+void gen_config_default(GenConfig *cfg) {
+    cfg->target_bytes = 1u << 20;
+    cfg->locals = 16;
+    cfg->expr_depth = 3;
+    cfg->comment_pct = 10;
+    cfg->string_pct = 10;
+    cfg->seed = 0x2545f491u;
+}
+
+char *gen_java_source(const GenConfig *cfg, size_t *out_len) {
+    GenBuf b = {0};
+    b.rng = cfg->seed ? cfg->seed : 1u;
+    int locals = cfg->locals < 1 ? 1 : cfg->locals;
+    if (locals > GEN_MAX_LOCALS) {
+        locals = GEN_MAX_LOCALS;
+    }
+    int depth = cfg->expr_depth < 0 ? 0 : cfg->expr_depth;
+
+    buf_printf(&b, "public class Bench {\n");
+    buf_printf(&b, "    public static void main(String[] args) {\n");
+    for (int i = 0; i < locals; i++) {
+        buf_printf(&b, "        int v%d = %d;\n", i, i + 1);
+    }
+    buf_printf(&b, "        String s = \"start\";\n");
+
+    while (b.len < cfg->target_bytes && !b.failed) {
+        if (gen_pct(&b, cfg->comment_pct)) {
+            gen_comment(&b);
+        }
+        if (gen_pct(&b, cfg->string_pct)) {
+            if (gen_rand(&b) % 2) {
+                buf_printf(&b, "        s = ");
+                gen_string_lit(&b);
+                buf_printf(&b, " + %u;\n", gen_rand(&b) % 100);
+            } else {
+                buf_printf(&b, "        System.out.println(");
+                gen_string_lit(&b);
+                buf_printf(&b, ");\n");
+            }
+            continue;
+        }
+        int target = (int)(gen_rand(&b) % (unsigned)locals);
+        switch (gen_rand(&b) % 8) {
+            case 0:
+                buf_printf(&b, "        v%d++;\n", target);
+                break;
+            case 1:
+                buf_printf(&b, "        System.out.println(v%d);\n", target);
+                break;
+            default:
+                buf_printf(&b, "        v%d = ", target);
+                gen_int_expr(&b, depth, locals);
+                buf_printf(&b, ";\n");
+                break;
+        }
+    }
+
+    buf_printf(&b, "    }\n}\n");
+    if (b.failed) {
+        free(b.data);
+        return NULL;
+    }
+    *out_len = b.len;
+    return b.data;
+}
+
+/* Calls only go to higher-numbered classes, so the project has no call cycles. */
+static int gen_callee(GenBuf *b, int index, int files) {
+    int ahead = files - index - 1;
+    if (ahead <= 0) return -1;
+    return index + 1 + (int)(gen_rand(b) % (unsigned)(ahead < 8 ? ahead : 8));
+}
+
+char *gen_java_project_file(const GenConfig *cfg, int index, int files, size_t *out_len) {
+    GenBuf b = {0};
+    b.rng = (cfg->seed ? cfg->seed : 1u) ^ (2654435761u * (unsigned)(index + 1));
+    int depth = cfg->expr_depth < 0 ? 0 : cfg->expr_depth;
+
+    buf_printf(&b, "public class C%d {\n", index);
+    int m = 0;
+    while ((b.len < cfg->target_bytes || m == 0) && !b.failed) {
+        buf_printf(&b, "    static int f%d(int v0, C%d self) {\n", m, index);
+        buf_printf(&b, "        int v1 = v0 + %u;\n", gen_rand(&b) % 100);
+        for (int i = 0; i < 4; i++) {
+            if (gen_pct(&b, cfg->comment_pct)) {
+                gen_comment(&b);
+            }
+            buf_printf(&b, "        v%d = ", i % 2);
+            gen_int_expr(&b, depth, 2);
+            buf_printf(&b, ";\n");
+        }
+        int callee = gen_callee(&b, index, files);
+        if (callee >= 0) {
+            buf_printf(&b, "        C%d other = new C%d();\n", callee, callee);
+            buf_printf(&b, "        v1 = v1 + C%d.f0(v0 %% 97, other);\n", callee);
+        }
+        if (m > 0) {
+            buf_printf(&b, "        v1 = v1 + f%u(v0 / 2, self);\n", gen_rand(&b) % (unsigned)m);
+        }
+        buf_printf(&b, "        return v1;\n    }\n");
+        m++;
+    }
+    if (index == 0) {
+        buf_printf(&b, "    public static void main(String[] args) {\n");
+        buf_printf(&b, "        System.out.println(f0(1, new C0()));\n    }\n");
+    }
+    buf_printf(&b, "}\n");
+    if (b.failed) {
+        free(b.data);
+        return NULL;
+    }
+    *out_len = b.len;
+    return b.data;
+}
+
+char *gen_java_startup(int classes, size_t *out_len) {
+    GenBuf b = {0};
+    buf_printf(&b, "public class Startup {\n    public static void main(String[] args) {\n        int s = 0;\n");
+    for (int k = 0; k < classes; k++) {
+        buf_printf(&b, "        s = C%d.f(s);\n", k);
+    }
+    buf_printf(&b, "        System.out.println(s);\n    }\n}\n");
+    for (int k = 0; k < classes; k++) {
+        buf_printf(&b,
+                   "\nclass C%d {\n"
+                   "    static int f(int x) {\n"
+                   "        int s = x;\n"
+                   "        for (int i = 0; i < %d; i++) {\n"
+                   "            s = s + i;\n"
+                   "        }\n"
+                   "        return s;\n"
+                   "    }\n"
+                   "}\n",
+                   k, k % 5 + 1);
+    }
+    if (b.failed) {
+        free(b.data);
+        return NULL;
+    }
+    *out_len = b.len;
+    return b.data;
+}
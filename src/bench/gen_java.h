@@ -0,0 +1,31 @@
+#ifndef TINYJVM_GEN_JAVA_H
+#define TINYJVM_GEN_JAVA_H
+
+#include <stddef.h>
+
+typedef struct {
+    size_t target_bytes;
+    int locals;
+    int expr_depth;
+    int comment_pct;
+    int string_pct;
+    unsigned seed;
+} GenConfig;
+
+void gen_config_default(GenConfig *cfg);
+char *gen_java_source(const GenConfig *cfg, size_t *out_len);
+
+/*
+ * File index of a generated project of files classes, C0 to C<files-1>.
+ * Each class has about target_bytes of static methods that call methods
+ * and allocate objects of other classes. C0 holds main.
+ */
+char *gen_java_project_file(const GenConfig *cfg, int index, int files, size_t *out_len);
+
+/*
+ * The VM startup workload: class Startup whose main calls a small static
+ * method in each of classes classes, so the VM loads classes + 1 of them.
+ */
+char *gen_java_startup(int classes, size_t *out_len);
+
+#endif
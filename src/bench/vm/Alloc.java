@@ -0,0 +1,14 @@
+public class Alloc {
+    static Alloc churn(int n) {
+        Alloc last = new Alloc();
+        for (int i = 1; i < n; i++) {
+            last = new Alloc();
+        }
+        return last;
+    }
+
+    public static void main(String[] args) {
+        Alloc a = churn(5000000);
+        System.out.println("done");
+    }
+}
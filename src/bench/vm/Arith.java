@@ -0,0 +1,9 @@
+public class Arith {
+    public static void main(String[] args) {
+        int acc = 1;
+        for (int i = 0; i < 20000000; i++) {
+            acc = acc * 31 + i % 7 - acc / 3;
+        }
+        System.out.println(acc);
+    }
+}
@@ -0,0 +1,8 @@
+public class Println {
+    public static void main(String[] args) {
+        for (int i = 0; i < 100000; i++) {
+            System.out.println(i);
+            System.out.println("the quick brown fox jumps over the lazy dog");
+        }
+    }
+}
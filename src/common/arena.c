@@ -46,3 +46,33 @@ void *arena_alloc(Arena *arena, size_t size) {
     memset(ptr, 0, size);
     return ptr;
 }
+
+void arena_stats(const Arena *arena, ArenaStats *out) {
+    out->chunks = 0;
+    out->reserved = 0;
+    out->used = 0;
+    for (const ArenaChunk *chunk = arena->head; chunk; chunk = chunk->next) {
+        out->chunks++;
+        out->reserved += chunk->cap;
+        out->used += chunk->used;
+    }
+}
+
+ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark;
+    mark.chunk = arena->head;
+    mark.used = arena->head ? arena->head->used : 0;
+    return mark;
+}
+
+/* Frees every chunk started after the mark; newer chunks are always in front. */
+void arena_reset(Arena *arena, ArenaMark mark) {
+    while (arena->head && arena->head != mark.chunk) {
+        ArenaChunk *next = arena->head->next;
+        free(arena->head);
+        arena->head = next;
+    }
+    if (arena->head) {
+        arena->head->used = mark.used;
+    }
+}
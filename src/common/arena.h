@@ -14,8 +14,22 @@ typedef struct {
     ArenaChunk *head;
 } Arena;
 
+typedef struct {
+    ArenaChunk *chunk;
+    size_t used;
+} ArenaMark;
+
+typedef struct {
+    size_t chunks;
+    size_t reserved;
+    size_t used;
+} ArenaStats;
+
 void arena_init(Arena *arena);
 void arena_free(Arena *arena);
 void *arena_alloc(Arena *arena, size_t size);
+void arena_stats(const Arena *arena, ArenaStats *out);
+ArenaMark arena_mark(const Arena *arena);
+void arena_reset(Arena *arena, ArenaMark mark);
 
 #endif
@@ -0,0 +1,174 @@
+#include "ast.h"
+
+#include <stdlib.h>
+
+Ast *ast_find_method(Ast *clazz, Str callee) {
+    if (!clazz) return NULL;
+    Str name = clazz->as.class_decl.name;
+    /* Accept both foo(...) and ClassName.foo(...). */
+    if (callee.len > name.len + 1 && callee.data[name.len] == '.') {
+        Str prefix = {callee.data, name.len};
+        if (str_eq(prefix, name)) {
+            callee.data += name.len + 1;
+            callee.len -= name.len + 1;
+        }
+    }
+    for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+        if (member->kind == AST_METHOD && str_eq(member->as.method_decl.name, callee)) {
+            return member;
+        }
+    }
+    return NULL;
+}
+
+static int visit_chain(Ast *node, AstVisitFn fn, void *user) {
+    for (; node; node = node->next) {
+        if (ast_visit(node, fn, user)) return 1;
+    }
+    return 0;
+}
+
+/* Pre-order walk of node and its children (not its siblings); stops when fn returns nonzero. */
+int ast_visit(Ast *node, AstVisitFn fn, void *user) {
+    if (!node) return 0;
+    if (fn(node, user)) return 1;
+    switch (node->kind) {
+        case AST_METHOD:
+            return visit_chain(node->as.method_decl.params, fn, user) ||
+                   ast_visit(node->as.method_decl.body, fn, user);
+        case AST_BLOCK:
+            return visit_chain(node->as.block.stmts, fn, user);
+        case AST_RETURN:
+            return ast_visit(node->as.return_stmt.expr, fn, user);
+        case AST_IF:
+            return ast_visit(node->as.if_stmt.cond, fn, user) ||
+                   ast_visit(node->as.if_stmt.then_branch, fn, user) ||
+                   ast_visit(node->as.if_stmt.else_branch, fn, user);
+        case AST_WHILE:
+            return ast_visit(node->as.while_stmt.cond, fn, user) ||
+                   ast_visit(node->as.while_stmt.body, fn, user);
+        case AST_FOR:
+            return ast_visit(node->as.for_stmt.init, fn, user) ||
+                   ast_visit(node->as.for_stmt.cond, fn, user) ||
+                   ast_visit(node->as.for_stmt.update, fn, user) ||
+                   ast_visit(node->as.for_stmt.body, fn, user);
+        case AST_VAR_DECL:
+            return ast_visit(node->as.var_decl.init, fn, user);
+        case AST_EXPR_STMT:
+            return ast_visit(node->as.expr_stmt.expr, fn, user);
+        case AST_ASSIGN:
+            return ast_visit(node->as.assign.value, fn, user);
+        case AST_BIN:
+            return ast_visit(node->as.bin.lhs, fn, user) ||
+                   ast_visit(node->as.bin.rhs, fn, user);
+        case AST_CALL:
+            return visit_chain(node->as.call.args, fn, user);
+        default:
+            return 0;
+    }
+}
+
+typedef struct {
+    size_t n;
+    size_t limit;
+} NodeCount;
+
+static int count_node(Ast *node, void *user) {
+    (void)node;
+    NodeCount *c = (NodeCount *)user;
+    return ++c->n > c->limit;
+}
+
+/* Counts node and everything below it, stopping once the count passes limit. */
+size_t ast_count_nodes(Ast *node, size_t limit) {
+    NodeCount c = {0, limit};
+    ast_visit(node, count_node, &c);
+    return c.n;
+}
+
+static int is_pure_node(const Ast *node) {
+    switch (node->kind) {
+        case AST_INT_LIT:
+        case AST_STRING_LIT:
+        case AST_IDENT:
+            return 1;
+        case AST_BIN:
+            return node->as.bin.op != TOK_SLASH && node->as.bin.op != TOK_PERCENT;
+        default:
+            return 0;
+    }
+}
+
+/* True when evaluating expr can be skipped or repeated. Calls and division (which can throw) are not. */
+int ast_is_pure(const Ast *expr) {
+    if (expr->kind != AST_BIN) {
+        return is_pure_node(expr);
+    }
+    if (!expr->as.bin.post) {
+        return is_pure_node(expr) && ast_is_pure(expr->as.bin.lhs) && ast_is_pure(expr->as.bin.rhs);
+    }
+    for (size_t i = 0; i < expr->as.bin.post_len; i++) {
+        if (!is_pure_node(expr->as.bin.post[i])) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Recomputes the post-order slices of an expression after a pass has
+ * replaced some of its operands. Iterative, like the parser that built them.
+ */
+int ast_rebuild_post(Arena *arena, Ast *expr) {
+    if (!expr || expr->kind != AST_BIN) return 1;
+
+    size_t cap = 64;
+    size_t todo_len = 0;
+    size_t out_len = 0;
+    Ast **todo = (Ast **)malloc(cap * sizeof(Ast *));
+    Ast **out = (Ast **)malloc(cap * sizeof(Ast *));
+    if (!todo || !out) goto fail;
+
+    /* Root, rhs, lhs order; reversed it is the post-order. */
+    todo[todo_len++] = expr;
+    while (todo_len) {
+        Ast *node = todo[--todo_len];
+        if (out_len + 2 >= cap) {
+            cap *= 2;
+            Ast **grown_todo = (Ast **)realloc(todo, cap * sizeof(Ast *));
+            if (grown_todo) todo = grown_todo;
+            Ast **grown_out = (Ast **)realloc(out, cap * sizeof(Ast *));
+            if (grown_out) out = grown_out;
+            if (!grown_todo || !grown_out) goto fail;
+        }
+        out[out_len++] = node;
+        if (node->kind == AST_BIN) {
+            todo[todo_len++] = node->as.bin.lhs;
+            todo[todo_len++] = node->as.bin.rhs;
+        }
+    }
+
+    Ast **post = (Ast **)arena_alloc(arena, out_len * sizeof(Ast *));
+    if (!post) goto fail;
+    /* todo is reused as the stack of subtree start indices. */
+    size_t *starts = (size_t *)todo;
+    size_t depth = 0;
+    for (size_t i = 0; i < out_len; i++) {
+        Ast *node = out[out_len - 1 - i];
+        post[i] = node;
+        size_t start = i;
+        if (node->kind == AST_BIN) {
+            depth--;
+            start = starts[--depth];
+            node->as.bin.post = post + start;
+            node->as.bin.post_len = i + 1 - start;
+        }
+        starts[depth++] = start;
+    }
+    free(todo);
+    free(out);
+    return 1;
+
+fail:
+    free(todo);
+    free(out);
+    return 0;
+}
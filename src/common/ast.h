@@ -2,6 +2,7 @@
 #define TINYJVM_AST_H
 
 #include <stddef.h>
+#include "arena.h"
 #include "token.h"
 #include "str.h"
 
@@ -13,6 +14,9 @@ typedef enum {
     AST_METHOD,
     AST_BLOCK,
     AST_RETURN,
+    AST_IF,
+    AST_WHILE,
+    AST_FOR,
     AST_VAR_DECL,
     AST_EXPR_STMT,
     AST_ASSIGN,
@@ -22,7 +26,8 @@ typedef enum {
     AST_STRING_LIT,
     AST_IDENT,
     AST_CALL,
-    AST_NEW
+    AST_NEW,
+    AST_KIND_COUNT
 } AstKind;
 
 typedef struct Ast Ast;
@@ -60,6 +65,21 @@ struct Ast {
         struct {
             Ast *expr;
         } return_stmt;
+        struct {
+            Ast *cond;
+            Ast *then_branch;
+            Ast *else_branch;
+        } if_stmt;
+        struct {
+            Ast *cond;
+            Ast *body;
+        } while_stmt;
+        struct {
+            Ast *init;
+            Ast *cond;
+            Ast *update;
+            Ast *body;
+        } for_stmt;
         struct {
             Str name;
             Str type;
@@ -79,6 +99,9 @@ struct Ast {
             TokenType op;
             Ast *lhs;
             Ast *rhs;
+            /* This subtree in post-order (operands before operators), ending with this node. */
+            Ast **post;
+            size_t post_len;
         } bin;
         struct {
             int value;
@@ -99,4 +122,13 @@ struct Ast {
     } as;
 };
 
+/* Tree utilities for the passes that rewrite the AST between checking and emission. */
+typedef int (*AstVisitFn)(Ast *node, void *user);
+
+Ast *ast_find_method(Ast *clazz, Str callee);
+int ast_visit(Ast *node, AstVisitFn fn, void *user);
+size_t ast_count_nodes(Ast *node, size_t limit);
+int ast_is_pure(const Ast *expr);
+int ast_rebuild_post(Arena *arena, Ast *expr);
+
 #endif
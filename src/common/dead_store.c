@@ -0,0 +1,474 @@
+#include "dead_store.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint64_t Word;
+
+typedef enum {
+    SLOT_LIST,     /* element of a statement list: can be unlinked */
+    SLOT_OPTIONAL, /* for init/update: can become NULL */
+    SLOT_REQUIRED  /* branch or loop body: becomes an empty block */
+} SlotKind;
+
+typedef enum {
+    STORE_DROP,
+    STORE_CALL,
+    STORE_KEEP
+} StoreFate;
+
+typedef struct {
+    Arena *arena;
+    DeadStoreStats *stats;
+    Str *names;
+    int name_count;
+    int name_cap;
+    size_t words;
+    int oom;
+} DseCtx;
+
+static int name_index(DseCtx *ctx, Str name) {
+    for (int i = 0; i < ctx->name_count; i++) {
+        if (str_eq(ctx->names[i], name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void name_add(DseCtx *ctx, Str name) {
+    if (name_index(ctx, name) >= 0) return;
+    if (ctx->name_count == ctx->name_cap) {
+        int cap = ctx->name_cap ? ctx->name_cap * 2 : 32;
+        Str *grown = (Str *)realloc(ctx->names, (size_t)cap * sizeof(Str));
+        if (!grown) {
+            ctx->oom = 1;
+            return;
+        }
+        ctx->names = grown;
+        ctx->name_cap = cap;
+    }
+    ctx->names[ctx->name_count++] = name;
+}
+
+static void collect_names(DseCtx *ctx, Ast *stmt) {
+    for (; stmt; stmt = stmt->next) {
+        switch (stmt->kind) {
+            case AST_VAR_DECL:
+                name_add(ctx, stmt->as.var_decl.name);
+                break;
+            case AST_BLOCK:
+                collect_names(ctx, stmt->as.block.stmts);
+                break;
+            case AST_IF:
+                collect_names(ctx, stmt->as.if_stmt.then_branch);
+                collect_names(ctx, stmt->as.if_stmt.else_branch);
+                break;
+            case AST_WHILE:
+                collect_names(ctx, stmt->as.while_stmt.body);
+                break;
+            case AST_FOR:
+                collect_names(ctx, stmt->as.for_stmt.init);
+                collect_names(ctx, stmt->as.for_stmt.body);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static Word *bits_new(DseCtx *ctx) {
+    Word *bits = (Word *)calloc(ctx->words, sizeof(Word));
+    if (!bits) ctx->oom = 1;
+    return bits;
+}
+
+static Word *bits_copy(DseCtx *ctx, const Word *src) {
+    Word *bits = bits_new(ctx);
+    if (bits) memcpy(bits, src, ctx->words * sizeof(Word));
+    return bits;
+}
+
+static void bit_set(Word *bits, int i) {
+    if (i >= 0) bits[i / 64] |= (Word)1 << (i % 64);
+}
+
+static void bit_clear(Word *bits, int i) {
+    if (i >= 0) bits[i / 64] &= ~((Word)1 << (i % 64));
+}
+
+static int bit_test(const Word *bits, int i) {
+    return i >= 0 && (bits[i / 64] >> (i % 64)) & 1;
+}
+
+static void bits_or(DseCtx *ctx, Word *dst, const Word *src) {
+    for (size_t i = 0; i < ctx->words; i++) {
+        dst[i] |= src[i];
+    }
+}
+
+static void expr_uses(DseCtx *ctx, Ast *expr, Word *live) {
+    if (!expr) return;
+    switch (expr->kind) {
+        case AST_IDENT:
+            bit_set(live, name_index(ctx, expr->as.ident.name));
+            break;
+        case AST_BIN:
+            if (!expr->as.bin.post) {
+                expr_uses(ctx, expr->as.bin.lhs, live);
+                expr_uses(ctx, expr->as.bin.rhs, live);
+                break;
+            }
+            for (size_t i = 0; i < expr->as.bin.post_len; i++) {
+                if (expr->as.bin.post[i]->kind != AST_BIN) {
+                    expr_uses(ctx, expr->as.bin.post[i], live);
+                }
+            }
+            break;
+        case AST_CALL:
+            for (Ast *arg = expr->as.call.args; arg; arg = arg->next) {
+                expr_uses(ctx, arg, live);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static StoreFate dead_store_fate(Ast *value) {
+    if (!value || ast_is_pure(value)) return STORE_DROP;
+    if (value->kind == AST_CALL) return STORE_CALL;
+    return STORE_KEEP;
+}
+
+static Ast *new_node(DseCtx *ctx, AstKind kind, Token tok) {
+    Ast *node = (Ast *)arena_alloc(ctx->arena, sizeof(Ast));
+    if (!node) {
+        ctx->oom = 1;
+        return NULL;
+    }
+    node->kind = kind;
+    node->tok = tok;
+    return node;
+}
+
+static void replace_stmt(Ast **slot, Ast *with) {
+    with->next = (*slot)->next;
+    *slot = with;
+}
+
+static void remove_stmt(DseCtx *ctx, Ast **slot, SlotKind kind) {
+    Ast *stmt = *slot;
+    if (kind == SLOT_LIST) {
+        *slot = stmt->next;
+    } else if (kind == SLOT_OPTIONAL) {
+        *slot = NULL;
+    } else {
+        Ast *empty = new_node(ctx, AST_BLOCK, stmt->tok);
+        if (empty) replace_stmt(slot, empty);
+    }
+}
+
+static Ast *call_stmt(DseCtx *ctx, Ast *call) {
+    Ast *node = new_node(ctx, AST_EXPR_STMT, call->tok);
+    if (node) node->as.expr_stmt.expr = call;
+    return node;
+}
+
+static void stmt_live(DseCtx *ctx, Ast **slot, SlotKind kind, Word *live, int rewrite);
+
+/* Statements are visited last to first through their slots, so unlinking one only touches its predecessor. */
+static void list_live(DseCtx *ctx, Ast **head, Word *live, int rewrite) {
+    size_t n = 0;
+    for (Ast **s = head; *s; s = &(*s)->next) {
+        n++;
+    }
+    if (!n) return;
+    Ast ***slots = (Ast ***)malloc(n * sizeof(Ast **));
+    if (!slots) {
+        ctx->oom = 1;
+        return;
+    }
+    n = 0;
+    for (Ast **s = head; *s; s = &(*s)->next) {
+        slots[n++] = s;
+    }
+    while (n-- > 0) {
+        stmt_live(ctx, slots[n], SLOT_LIST, live, rewrite);
+    }
+    free(slots);
+}
+
+/* Live set at the head of a loop: what the exit needs, what cond reads and what the body (plus update) needs on the next trip. */
+static Word *loop_head(DseCtx *ctx, Ast *cond, Ast *update, Ast *body, const Word *out) {
+    Word *head = bits_copy(ctx, out);
+    if (!head) return NULL;
+    expr_uses(ctx, cond, head);
+    for (;;) {
+        Word *trip = bits_copy(ctx, head);
+        if (!trip) break;
+        Ast *update_copy = update;
+        Ast *body_copy = body;
+        stmt_live(ctx, &update_copy, SLOT_OPTIONAL, trip, 0);
+        stmt_live(ctx, &body_copy, SLOT_REQUIRED, trip, 0);
+        bits_or(ctx, trip, head);
+        int same = memcmp(trip, head, ctx->words * sizeof(Word)) == 0;
+        free(head);
+        head = trip;
+        if (same || ctx->oom) break;
+    }
+    return head;
+}
+
+/*
+ * Transforms live from the set after *slot to the set before it. With
+ * rewrite off this only computes the effect the rewrite would have, which
+ * is what loop fixpoints need.
+ */
+static void stmt_live(DseCtx *ctx, Ast **slot, SlotKind kind, Word *live, int rewrite) {
+    Ast *stmt = *slot;
+    if (!stmt || ctx->oom) return;
+    switch (stmt->kind) {
+        case AST_VAR_DECL: {
+            int v = name_index(ctx, stmt->as.var_decl.name);
+            Ast *init = stmt->as.var_decl.init;
+            StoreFate fate = init && !bit_test(live, v) ? dead_store_fate(init) : STORE_KEEP;
+            if (fate == STORE_CALL && kind != SLOT_LIST) {
+                fate = STORE_KEEP;
+            }
+            bit_clear(live, v);
+            if (fate == STORE_KEEP) {
+                expr_uses(ctx, init, live);
+                break;
+            }
+            if (fate == STORE_CALL) {
+                expr_uses(ctx, init, live);
+            }
+            if (rewrite) {
+                stmt->as.var_decl.init = NULL;
+                if (fate == STORE_CALL) {
+                    Ast *call = call_stmt(ctx, init);
+                    if (!call) break;
+                    call->next = stmt->next;
+                    stmt->next = call;
+                }
+                ctx->stats->stores_removed++;
+            }
+        } break;
+        case AST_ASSIGN: {
+            int v = name_index(ctx, stmt->as.assign.name);
+            Ast *value = stmt->as.assign.value;
+            StoreFate fate = bit_test(live, v) ? STORE_KEEP : dead_store_fate(value);
+            bit_clear(live, v);
+            if (fate != STORE_DROP) {
+                expr_uses(ctx, value, live);
+            }
+            if (!rewrite || fate == STORE_KEEP) break;
+            if (fate == STORE_DROP) {
+                remove_stmt(ctx, slot, kind);
+            } else {
+                Ast *call = call_stmt(ctx, value);
+                if (call) replace_stmt(slot, call);
+            }
+            ctx->stats->stores_removed++;
+        } break;
+        case AST_INC: {
+            int v = name_index(ctx, stmt->as.inc.name);
+            if (bit_test(live, v)) break;
+            if (rewrite) {
+                remove_stmt(ctx, slot, kind);
+                ctx->stats->stores_removed++;
+            }
+        } break;
+        case AST_EXPR_STMT: {
+            Ast *expr = stmt->as.expr_stmt.expr;
+            if (!expr || !ast_is_pure(expr)) {
+                expr_uses(ctx, expr, live);
+                break;
+            }
+            if (rewrite) {
+                remove_stmt(ctx, slot, kind);
+                ctx->stats->exprs_removed++;
+            }
+        } break;
+        case AST_RETURN:
+            memset(live, 0, ctx->words * sizeof(Word));
+            expr_uses(ctx, stmt->as.return_stmt.expr, live);
+            break;
+        case AST_BLOCK:
+            list_live(ctx, &stmt->as.block.stmts, live, rewrite);
+            break;
+        case AST_IF: {
+            Word *other = bits_copy(ctx, live);
+            if (!other) break;
+            stmt_live(ctx, &stmt->as.if_stmt.then_branch, SLOT_REQUIRED, live, rewrite);
+            stmt_live(ctx, &stmt->as.if_stmt.else_branch, SLOT_REQUIRED, other, rewrite);
+            bits_or(ctx, live, other);
+            free(other);
+            expr_uses(ctx, stmt->as.if_stmt.cond, live);
+        } break;
+        case AST_WHILE: {
+            Word *head = loop_head(ctx, stmt->as.while_stmt.cond, NULL, stmt->as.while_stmt.body, live);
+            if (!head) break;
+            if (rewrite) {
+                Word *trip = bits_copy(ctx, head);
+                if (trip) stmt_live(ctx, &stmt->as.while_stmt.body, SLOT_REQUIRED, trip, 1);
+                free(trip);
+            }
+            memcpy(live, head, ctx->words * sizeof(Word));
+            free(head);
+        } break;
+        case AST_FOR: {
+            Word *head = loop_head(ctx, stmt->as.for_stmt.cond, stmt->as.for_stmt.update, stmt->as.for_stmt.body, live);
+            if (!head) break;
+            if (rewrite) {
+                Word *trip = bits_copy(ctx, head);
+                if (trip) {
+                    stmt_live(ctx, &stmt->as.for_stmt.update, SLOT_OPTIONAL, trip, 1);
+                    stmt_live(ctx, &stmt->as.for_stmt.body, SLOT_REQUIRED, trip, 1);
+                }
+                free(trip);
+            }
+            memcpy(live, head, ctx->words * sizeof(Word));
+            free(head);
+            stmt_live(ctx, &stmt->as.for_stmt.init, SLOT_OPTIONAL, live, rewrite);
+        } break;
+        default:
+            break;
+    }
+}
+
+static void collect_refs(DseCtx *ctx, Ast *stmt, Word *refs) {
+    for (; stmt; stmt = stmt->next) {
+        switch (stmt->kind) {
+            case AST_VAR_DECL:
+                if (stmt->as.var_decl.init) {
+                    bit_set(refs, name_index(ctx, stmt->as.var_decl.name));
+                    expr_uses(ctx, stmt->as.var_decl.init, refs);
+                }
+                break;
+            case AST_ASSIGN:
+                bit_set(refs, name_index(ctx, stmt->as.assign.name));
+                expr_uses(ctx, stmt->as.assign.value, refs);
+                break;
+            case AST_INC:
+                bit_set(refs, name_index(ctx, stmt->as.inc.name));
+                break;
+            case AST_EXPR_STMT:
+                expr_uses(ctx, stmt->as.expr_stmt.expr, refs);
+                break;
+            case AST_RETURN:
+                expr_uses(ctx, stmt->as.return_stmt.expr, refs);
+                break;
+            case AST_BLOCK:
+                collect_refs(ctx, stmt->as.block.stmts, refs);
+                break;
+            case AST_IF:
+                expr_uses(ctx, stmt->as.if_stmt.cond, refs);
+                collect_refs(ctx, stmt->as.if_stmt.then_branch, refs);
+                collect_refs(ctx, stmt->as.if_stmt.else_branch, refs);
+                break;
+            case AST_WHILE:
+                expr_uses(ctx, stmt->as.while_stmt.cond, refs);
+                collect_refs(ctx, stmt->as.while_stmt.body, refs);
+                break;
+            case AST_FOR:
+                collect_refs(ctx, stmt->as.for_stmt.init, refs);
+                expr_uses(ctx, stmt->as.for_stmt.cond, refs);
+                collect_refs(ctx, stmt->as.for_stmt.update, refs);
+                collect_refs(ctx, stmt->as.for_stmt.body, refs);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static int unused_decl(DseCtx *ctx, Ast *stmt, const Word *refs) {
+    return stmt && stmt->kind == AST_VAR_DECL && !stmt->as.var_decl.init &&
+           !bit_test(refs, name_index(ctx, stmt->as.var_decl.name));
+}
+
+static void sweep_decls(DseCtx *ctx, Ast **slot, SlotKind kind, const Word *refs);
+
+static void sweep_list(DseCtx *ctx, Ast **head, const Word *refs) {
+    Ast **s = head;
+    while (*s) {
+        if (unused_decl(ctx, *s, refs)) {
+            *s = (*s)->next;
+            ctx->stats->locals_removed++;
+            continue;
+        }
+        sweep_decls(ctx, s, SLOT_LIST, refs);
+        s = &(*s)->next;
+    }
+}
+
+static void sweep_decls(DseCtx *ctx, Ast **slot, SlotKind kind, const Word *refs) {
+    Ast *stmt = *slot;
+    if (!stmt) return;
+    if (kind != SLOT_LIST && unused_decl(ctx, stmt, refs)) {
+        remove_stmt(ctx, slot, kind);
+        ctx->stats->locals_removed++;
+        return;
+    }
+    switch (stmt->kind) {
+        case AST_BLOCK:
+            sweep_list(ctx, &stmt->as.block.stmts, refs);
+            break;
+        case AST_IF:
+            sweep_decls(ctx, &stmt->as.if_stmt.then_branch, SLOT_REQUIRED, refs);
+            sweep_decls(ctx, &stmt->as.if_stmt.else_branch, SLOT_REQUIRED, refs);
+            break;
+        case AST_WHILE:
+            sweep_decls(ctx, &stmt->as.while_stmt.body, SLOT_REQUIRED, refs);
+            break;
+        case AST_FOR:
+            sweep_decls(ctx, &stmt->as.for_stmt.init, SLOT_OPTIONAL, refs);
+            sweep_decls(ctx, &stmt->as.for_stmt.body, SLOT_REQUIRED, refs);
+            break;
+        default:
+            break;
+    }
+}
+
+static void eliminate_method(DseCtx *ctx, Ast *method) {
+    Ast *body = method->as.method_decl.body;
+    ctx->name_count = 0;
+    for (Ast *param = method->as.method_decl.params; param; param = param->next) {
+        name_add(ctx, param->as.var_decl.name);
+    }
+    collect_names(ctx, body);
+    if (ctx->oom) return;
+    ctx->words = (size_t)ctx->name_count / 64 + 1;
+
+    Word *live = bits_new(ctx);
+    if (!live) return;
+    stmt_live(ctx, &method->as.method_decl.body, SLOT_REQUIRED, live, 1);
+    memset(live, 0, ctx->words * sizeof(Word));
+    collect_refs(ctx, body, live);
+    sweep_decls(ctx, &method->as.method_decl.body, SLOT_REQUIRED, live);
+    free(live);
+}
+
+int dead_store_eliminate(Ast *comp_unit, Arena *arena, DeadStoreStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!comp_unit || !comp_unit->as.comp_unit.clazz) {
+        return 1;
+    }
+    DseCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.arena = arena;
+    ctx.stats = stats;
+    for (Ast *clazz = comp_unit->as.comp_unit.clazz; clazz && !ctx.oom; clazz = clazz->next) {
+        for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+            if (member->kind == AST_METHOD && member->as.method_decl.body) {
+                eliminate_method(&ctx, member);
+            }
+            if (ctx.oom) break;
+        }
+    }
+    free(ctx.names);
+    return !ctx.oom;
+}
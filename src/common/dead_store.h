@@ -0,0 +1,24 @@
+#ifndef TINYJVM_DEAD_STORE_H
+#define TINYJVM_DEAD_STORE_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+
+/*
+ * Backward liveness over each method body of a checked AST, run before slot
+ * allocation and emission. Stores whose value is never read are removed;
+ * when the stored value is a call, only the call is kept. Declarations
+ * left with no reads or stores are dropped, as are expression statements
+ * with no side effects. Locals are tracked by name, so sibling scopes that
+ * reuse a name share one entry, which only makes the result conservative.
+ */
+typedef struct {
+    size_t stores_removed;
+    size_t locals_removed;
+    size_t exprs_removed;
+} DeadStoreStats;
+
+int dead_store_eliminate(Ast *comp_unit, Arena *arena, DeadStoreStats *stats);
+
+#endif
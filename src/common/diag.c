@@ -2,12 +2,90 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 void diag_init(Diag *d, const char *path, const char *source, size_t len) {
     d->path = path;
     d->source = source;
     d->len = len;
     d->had_error = 0;
+    d->error_count = 0;
+    d->lines = NULL;
+    d->line_count = 0;
+    d->line_cap = 0;
+    d->buffered = 0;
+    d->buf = NULL;
+    d->buf_len = 0;
+    d->buf_cap = 0;
+}
+
+/* Shares the parent's source and line table (line_cap 0 marks it as borrowed). */
+void diag_init_buffered(Diag *d, const Diag *parent) {
+    diag_init(d, parent->path, parent->source, parent->len);
+    d->lines = parent->lines;
+    d->line_count = parent->line_count;
+    d->buffered = 1;
+}
+
+void diag_free(Diag *d) {
+    if (d->line_cap) {
+        free(d->lines);
+    }
+    d->lines = NULL;
+    d->line_count = 0;
+    d->line_cap = 0;
+    free(d->buf);
+    d->buf = NULL;
+    d->buf_len = 0;
+    d->buf_cap = 0;
+}
+
+static void diag_write(Diag *d, const char *text, size_t len) {
+    if (!d->buffered) {
+        fwrite(text, 1, len, stderr);
+        return;
+    }
+    if (d->buf_len + len > d->buf_cap) {
+        size_t cap = d->buf_cap ? d->buf_cap : 256;
+        while (d->buf_len + len > cap) {
+            cap *= 2;
+        }
+        char *buf = (char *)realloc(d->buf, cap);
+        if (!buf) {
+            return;
+        }
+        d->buf = buf;
+        d->buf_cap = cap;
+    }
+    memcpy(d->buf + d->buf_len, text, len);
+    d->buf_len += len;
+}
+
+void diag_merge(Diag *dst, Diag *src) {
+    if (src->buf_len) {
+        diag_write(dst, src->buf, src->buf_len);
+    }
+    if (src->had_error) {
+        dst->had_error = 1;
+    }
+    dst->error_count += src->error_count;
+    diag_free(src);
+}
+
+void diag_add_line(Diag *d, size_t pos, size_t line) {
+    if (d->line_count == d->line_cap) {
+        size_t cap = d->line_cap ? d->line_cap * 2 : 256;
+        DiagLine *lines = (DiagLine *)realloc(d->lines, cap * sizeof(DiagLine));
+        if (!lines) {
+            return;
+        }
+        d->lines = lines;
+        d->line_cap = cap;
+    }
+    d->lines[d->line_count].pos = pos;
+    d->lines[d->line_count].line = line;
+    d->line_count++;
 }
 
 static void diag_find_line(const char *src, size_t len, size_t pos, size_t *out_line_start, size_t *out_line_no) {
@@ -23,20 +101,54 @@ static void diag_find_line(const char *src, size_t len, size_t pos, size_t *out_
     *out_line_no = line;
 }
 
+static void diag_find_recorded_line(const Diag *d, size_t pos, size_t *out_line_start, size_t *out_line_no) {
+    size_t lo = 0;
+    size_t hi = d->line_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (d->lines[mid].pos <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        *out_line_start = 0;
+        *out_line_no = 1;
+        return;
+    }
+    *out_line_start = d->lines[lo - 1].pos;
+    *out_line_no = d->lines[lo - 1].line;
+}
+
 void diag_error(Diag *d, size_t pos, const char *fmt, ...) {
     size_t line_start = 0;
     size_t line_no = 1;
-    diag_find_line(d->source, d->len, pos, &line_start, &line_no);
+    if (d->source) {
+        diag_find_line(d->source, d->len, pos, &line_start, &line_no);
+    } else {
+        diag_find_recorded_line(d, pos, &line_start, &line_no);
+    }
 
     size_t col = pos >= line_start ? (pos - line_start + 1) : 1;
 
-    fprintf(stderr, "%s:%zu:%zu: error: ", d->path, line_no, col);
-
-    va_list args;
-    va_start(args, fmt);
-    vfprintf(stderr, fmt, args);
-    va_end(args);
-
-    fprintf(stderr, "\n");
+    char msg[1024];
+    int n = snprintf(msg, sizeof(msg), "%s:%zu:%zu: error: ", d->path, line_no, col);
+    if (n < 0) {
+        n = 0;
+    }
+    if ((size_t)n < sizeof(msg)) {
+        va_list args;
+        va_start(args, fmt);
+        int m = vsnprintf(msg + n, sizeof(msg) - (size_t)n, fmt, args);
+        va_end(args);
+        n = m < 0 ? n : n + m;
+    }
+    if ((size_t)n > sizeof(msg) - 2) {
+        n = (int)sizeof(msg) - 2;
+    }
+    msg[n++] = '\n';
+    diag_write(d, msg, (size_t)n);
     d->had_error = 1;
+    d->error_count++;
 }
@@ -3,14 +3,38 @@
 
 #include <stddef.h>
 
+typedef struct {
+    size_t pos;
+    size_t line;
+} DiagLine;
+
+/*
+ * When source is NULL (streaming input) positions are resolved through the
+ * line starts recorded by the lexer, one per line that holds a token.
+ * A buffered Diag (diag_init_buffered) collects formatted messages in buf
+ * instead of writing them to stderr, so that diagnostics produced on worker
+ * threads can be merged back in source order with diag_merge.
+ */
 typedef struct {
     const char *path;
     const char *source;
     size_t len;
     int had_error;
+    int error_count;
+    DiagLine *lines;
+    size_t line_count;
+    size_t line_cap;
+    int buffered;
+    char *buf;
+    size_t buf_len;
+    size_t buf_cap;
 } Diag;
 
 void diag_init(Diag *d, const char *path, const char *source, size_t len);
+void diag_init_buffered(Diag *d, const Diag *parent);
+void diag_free(Diag *d);
+void diag_merge(Diag *dst, Diag *src);
+void diag_add_line(Diag *d, size_t pos, size_t line);
 void diag_error(Diag *d, size_t pos, const char *fmt, ...);
 
 #endif
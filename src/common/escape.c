@@ -0,0 +1,357 @@
+#include "escape.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    SLOT_LIST,     /* element of a statement list: can be unlinked */
+    SLOT_OPTIONAL, /* for init/update: can become NULL */
+    SLOT_REQUIRED  /* branch or loop body: becomes an empty block */
+} SlotKind;
+
+typedef struct {
+    Str name;
+    int escapes;
+} ObjLocal;
+
+/* dst = src between two tracked locals: if dst escapes, so does src. */
+typedef struct {
+    int dst;
+    int src;
+} Copy;
+
+typedef struct {
+    Arena *arena;
+    EscapeStats *stats;
+    Str class_name;
+    ObjLocal *locals;
+    int local_count;
+    int local_cap;
+    Copy *copies;
+    int copy_count;
+    int copy_cap;
+    int oom;
+} EscapeCtx;
+
+static int local_index(EscapeCtx *ctx, Str name) {
+    for (int i = 0; i < ctx->local_count; i++) {
+        if (str_eq(ctx->locals[i].name, name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Names are per method, so a name that is not always the class type is never rewritten. */
+static void local_add(EscapeCtx *ctx, Str name, Str type) {
+    int is_object = str_eq(type, ctx->class_name);
+    int i = local_index(ctx, name);
+    if (i >= 0) {
+        if (!is_object) ctx->locals[i].escapes = 1;
+        return;
+    }
+    if (ctx->local_count == ctx->local_cap) {
+        int cap = ctx->local_cap ? ctx->local_cap * 2 : 32;
+        ObjLocal *grown = (ObjLocal *)realloc(ctx->locals, (size_t)cap * sizeof(ObjLocal));
+        if (!grown) {
+            ctx->oom = 1;
+            return;
+        }
+        ctx->locals = grown;
+        ctx->local_cap = cap;
+    }
+    ctx->locals[ctx->local_count].name = name;
+    ctx->locals[ctx->local_count].escapes = !is_object;
+    ctx->local_count++;
+}
+
+static void copy_add(EscapeCtx *ctx, int dst, int src) {
+    if (ctx->copy_count == ctx->copy_cap) {
+        int cap = ctx->copy_cap ? ctx->copy_cap * 2 : 32;
+        Copy *grown = (Copy *)realloc(ctx->copies, (size_t)cap * sizeof(Copy));
+        if (!grown) {
+            ctx->oom = 1;
+            return;
+        }
+        ctx->copies = grown;
+        ctx->copy_cap = cap;
+    }
+    ctx->copies[ctx->copy_count].dst = dst;
+    ctx->copies[ctx->copy_count].src = src;
+    ctx->copy_count++;
+}
+
+static void collect_locals(EscapeCtx *ctx, Ast *stmt) {
+    for (; stmt; stmt = stmt->next) {
+        switch (stmt->kind) {
+            case AST_VAR_DECL:
+                local_add(ctx, stmt->as.var_decl.name, stmt->as.var_decl.type);
+                break;
+            case AST_BLOCK:
+                collect_locals(ctx, stmt->as.block.stmts);
+                break;
+            case AST_IF:
+                collect_locals(ctx, stmt->as.if_stmt.then_branch);
+                collect_locals(ctx, stmt->as.if_stmt.else_branch);
+                break;
+            case AST_WHILE:
+                collect_locals(ctx, stmt->as.while_stmt.body);
+                break;
+            case AST_FOR:
+                collect_locals(ctx, stmt->as.for_stmt.init);
+                collect_locals(ctx, stmt->as.for_stmt.body);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void scan_expr(EscapeCtx *ctx, Ast *expr, int escaping) {
+    if (!expr) return;
+    switch (expr->kind) {
+        case AST_IDENT:
+            if (escaping) {
+                int i = local_index(ctx, expr->as.ident.name);
+                if (i >= 0) ctx->locals[i].escapes = 1;
+            }
+            break;
+        case AST_NEW:
+            ctx->stats->sites++;
+            break;
+        case AST_BIN:
+            if (!expr->as.bin.post) {
+                scan_expr(ctx, expr->as.bin.lhs, 0);
+                scan_expr(ctx, expr->as.bin.rhs, 0);
+                break;
+            }
+            for (size_t i = 0; i < expr->as.bin.post_len; i++) {
+                if (expr->as.bin.post[i]->kind != AST_BIN) {
+                    scan_expr(ctx, expr->as.bin.post[i], 0);
+                }
+            }
+            break;
+        case AST_CALL:
+            for (Ast *arg = expr->as.call.args; arg; arg = arg->next) {
+                scan_expr(ctx, arg, 1);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void scan_store(EscapeCtx *ctx, Str name, Ast *value) {
+    if (!value) return;
+    if (value->kind != AST_IDENT) {
+        scan_expr(ctx, value, 0);
+        return;
+    }
+    int src = local_index(ctx, value->as.ident.name);
+    if (src < 0) return;
+    int dst = local_index(ctx, name);
+    if (dst < 0) {
+        ctx->locals[src].escapes = 1;
+    } else {
+        copy_add(ctx, dst, src);
+    }
+}
+
+static void scan_stmt(EscapeCtx *ctx, Ast *stmt) {
+    for (; stmt; stmt = stmt->next) {
+        switch (stmt->kind) {
+            case AST_VAR_DECL:
+                scan_store(ctx, stmt->as.var_decl.name, stmt->as.var_decl.init);
+                break;
+            case AST_ASSIGN:
+                scan_store(ctx, stmt->as.assign.name, stmt->as.assign.value);
+                break;
+            case AST_EXPR_STMT:
+                scan_expr(ctx, stmt->as.expr_stmt.expr, 0);
+                break;
+            case AST_RETURN:
+                scan_expr(ctx, stmt->as.return_stmt.expr, 1);
+                break;
+            case AST_BLOCK:
+                scan_stmt(ctx, stmt->as.block.stmts);
+                break;
+            case AST_IF:
+                scan_expr(ctx, stmt->as.if_stmt.cond, 0);
+                scan_stmt(ctx, stmt->as.if_stmt.then_branch);
+                scan_stmt(ctx, stmt->as.if_stmt.else_branch);
+                break;
+            case AST_WHILE:
+                scan_expr(ctx, stmt->as.while_stmt.cond, 0);
+                scan_stmt(ctx, stmt->as.while_stmt.body);
+                break;
+            case AST_FOR:
+                scan_stmt(ctx, stmt->as.for_stmt.init);
+                scan_expr(ctx, stmt->as.for_stmt.cond, 0);
+                scan_stmt(ctx, stmt->as.for_stmt.update);
+                scan_stmt(ctx, stmt->as.for_stmt.body);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void propagate(EscapeCtx *ctx) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < ctx->copy_count; i++) {
+            Copy *c = &ctx->copies[i];
+            if (ctx->locals[c->dst].escapes && !ctx->locals[c->src].escapes) {
+                ctx->locals[c->src].escapes = 1;
+                changed = 1;
+            }
+        }
+    }
+}
+
+static int scalar_local(EscapeCtx *ctx, Str name) {
+    int i = local_index(ctx, name);
+    return i >= 0 && !ctx->locals[i].escapes;
+}
+
+static Ast *new_node(EscapeCtx *ctx, AstKind kind, Token tok) {
+    Ast *node = (Ast *)arena_alloc(ctx->arena, sizeof(Ast));
+    if (!node) {
+        ctx->oom = 1;
+        return NULL;
+    }
+    node->kind = kind;
+    node->tok = tok;
+    return node;
+}
+
+static void replace_stmt(Ast **slot, Ast *with) {
+    with->next = (*slot)->next;
+    *slot = with;
+}
+
+/* Returns 1 when the statement was unlinked from its list. */
+static int remove_stmt(EscapeCtx *ctx, Ast **slot, SlotKind kind) {
+    Ast *stmt = *slot;
+    if (kind == SLOT_LIST) {
+        *slot = stmt->next;
+        return 1;
+    }
+    if (kind == SLOT_OPTIONAL) {
+        *slot = NULL;
+    } else {
+        Ast *empty = new_node(ctx, AST_BLOCK, stmt->tok);
+        if (empty) replace_stmt(slot, empty);
+    }
+    return 0;
+}
+
+static Ast *call_stmt(EscapeCtx *ctx, Ast *call) {
+    Ast *node = new_node(ctx, AST_EXPR_STMT, call->tok);
+    if (node) node->as.expr_stmt.expr = call;
+    return node;
+}
+
+/* Drops a store into a scalar-replaced local, keeping a call that produced the value. */
+static int rewrite_store(EscapeCtx *ctx, Ast **slot, SlotKind kind, Ast *value) {
+    if (value && value->kind == AST_CALL) {
+        Ast *call = call_stmt(ctx, value);
+        if (call) replace_stmt(slot, call);
+        return 0;
+    }
+    if (value && value->kind == AST_NEW) {
+        ctx->stats->sites_eliminated++;
+    }
+    return remove_stmt(ctx, slot, kind);
+}
+
+static int rewrite_stmt(EscapeCtx *ctx, Ast **slot, SlotKind kind);
+
+static void rewrite_list(EscapeCtx *ctx, Ast **head) {
+    Ast **s = head;
+    while (*s && !ctx->oom) {
+        if (!rewrite_stmt(ctx, s, SLOT_LIST)) {
+            s = &(*s)->next;
+        }
+    }
+}
+
+static int rewrite_stmt(EscapeCtx *ctx, Ast **slot, SlotKind kind) {
+    Ast *stmt = *slot;
+    if (!stmt) return 0;
+    switch (stmt->kind) {
+        case AST_VAR_DECL: {
+            Ast *init = stmt->as.var_decl.init;
+            if (!scalar_local(ctx, stmt->as.var_decl.name)) break;
+            /* A for init can't hold a call statement, so that decl stays. */
+            if (init && init->kind == AST_CALL && kind != SLOT_LIST) break;
+            ctx->stats->locals_removed++;
+            return rewrite_store(ctx, slot, kind, init);
+        }
+        case AST_ASSIGN:
+            if (!scalar_local(ctx, stmt->as.assign.name)) break;
+            return rewrite_store(ctx, slot, kind, stmt->as.assign.value);
+        case AST_EXPR_STMT: {
+            Ast *expr = stmt->as.expr_stmt.expr;
+            if (!expr || expr->kind != AST_NEW) break;
+            ctx->stats->sites_eliminated++;
+            return remove_stmt(ctx, slot, kind);
+        }
+        case AST_BLOCK:
+            rewrite_list(ctx, &stmt->as.block.stmts);
+            break;
+        case AST_IF:
+            rewrite_stmt(ctx, &stmt->as.if_stmt.then_branch, SLOT_REQUIRED);
+            rewrite_stmt(ctx, &stmt->as.if_stmt.else_branch, SLOT_REQUIRED);
+            break;
+        case AST_WHILE:
+            rewrite_stmt(ctx, &stmt->as.while_stmt.body, SLOT_REQUIRED);
+            break;
+        case AST_FOR:
+            rewrite_stmt(ctx, &stmt->as.for_stmt.init, SLOT_OPTIONAL);
+            rewrite_stmt(ctx, &stmt->as.for_stmt.update, SLOT_OPTIONAL);
+            rewrite_stmt(ctx, &stmt->as.for_stmt.body, SLOT_REQUIRED);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void eliminate_method(EscapeCtx *ctx, Ast *method) {
+    ctx->local_count = 0;
+    ctx->copy_count = 0;
+    /* Parameters hold objects from the caller; they are tracked so copies out of them are seen. */
+    for (Ast *param = method->as.method_decl.params; param; param = param->next) {
+        local_add(ctx, param->as.var_decl.name, param->as.var_decl.type);
+    }
+    collect_locals(ctx, method->as.method_decl.body);
+    scan_stmt(ctx, method->as.method_decl.body);
+    if (ctx->oom) return;
+    propagate(ctx);
+    rewrite_stmt(ctx, &method->as.method_decl.body, SLOT_REQUIRED);
+}
+
+int escape_eliminate(Ast *comp_unit, Arena *arena, EscapeStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!comp_unit || !comp_unit->as.comp_unit.clazz) {
+        return 1;
+    }
+    EscapeCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.arena = arena;
+    ctx.stats = stats;
+    for (Ast *clazz = comp_unit->as.comp_unit.clazz; clazz && !ctx.oom; clazz = clazz->next) {
+        ctx.class_name = clazz->as.class_decl.name;
+        for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+            if (member->kind == AST_METHOD && member->as.method_decl.body) {
+                eliminate_method(&ctx, member);
+            }
+            if (ctx.oom) break;
+        }
+    }
+    free(ctx.locals);
+    free(ctx.copies);
+    return !ctx.oom;
+}
@@ -0,0 +1,25 @@
+#ifndef TINYJVM_ESCAPE_H
+#define TINYJVM_ESCAPE_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+
+/*
+ * Intraprocedural escape analysis over each method body of a checked AST,
+ * run before emission. An object escapes when it is returned or passed to
+ * a call, directly or through copies between locals. Objects that don't
+ * escape have no observable state, since the language has no field access,
+ * so scalar replacement leaves nothing: their `new`, the locals holding
+ * them and the copies between those locals are removed. Calls that stored
+ * into such a local are kept as statements.
+ */
+typedef struct {
+    size_t sites;
+    size_t sites_eliminated;
+    size_t locals_removed;
+} EscapeStats;
+
+int escape_eliminate(Ast *comp_unit, Arena *arena, EscapeStats *stats);
+
+#endif
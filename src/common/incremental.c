@@ -0,0 +1,472 @@
+#include "incremental.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "type_check.h"
+
+/* Arena that the members reparsed by one update live in, freed with the last of them. */
+struct IncGeneration {
+    Arena arena;
+    size_t live;
+    IncGeneration *next;
+};
+
+typedef struct {
+    Ast *clazz;
+    size_t first; /* its members' spans are spans[first..first+count) */
+    size_t count;
+    int changed;
+} IncClass;
+
+typedef struct {
+    Ast *decl;
+    size_t start;
+    size_t end;
+} IncSpan;
+
+typedef struct {
+    char *src;
+    Arena decl_arena;
+    Ast *unit;
+    IncClass *classes;
+    size_t class_count;
+    size_t class_cap;
+    IncSpan *spans;
+    size_t span_count;
+    size_t span_cap;
+    SymbolIndex symbols;
+    IncMember *members;
+    IncGeneration *gen;
+    size_t *table; /* previous members by owner and name, as index + 1 */
+    size_t table_cap;
+} IncUpdate;
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+static uint64_t hash_bytes(uint64_t h, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)s[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+/* Hashes s followed by a separator, so that consecutive strings can't run together. */
+static uint64_t hash_str(uint64_t h, Str s) {
+    return hash_bytes(h, s.data, s.len) * FNV_PRIME;
+}
+
+static Str member_name(const Ast *member) {
+    return member->kind == AST_METHOD ? member->as.method_decl.name : member->as.field_decl.name;
+}
+
+static size_t member_key(Str owner, Str name) {
+    return (size_t)hash_str(hash_str(FNV_OFFSET, owner), name);
+}
+
+static size_t imports_hash(const Ast *unit) {
+    uint64_t h = FNV_OFFSET;
+    for (const Ast *imp = unit->as.comp_unit.imports; imp; imp = imp->next) {
+        h = hash_str(h, imp->as.import_decl.name);
+    }
+    return (size_t)h;
+}
+
+static size_t signature_hash(const Ast *member) {
+    if (member->kind == AST_FIELD) {
+        return (size_t)hash_str(FNV_OFFSET ^ 'F', member->as.field_decl.type);
+    }
+    uint64_t h = hash_str(FNV_OFFSET ^ (member->as.method_decl.is_static ? 'S' : 'M'), member->as.method_decl.ret_type);
+    for (const Ast *p = member->as.method_decl.params; p; p = p->next) {
+        h = hash_str(h, p->as.var_decl.type);
+    }
+    return (size_t)h;
+}
+
+/*
+ * Bodies that checked cleanly only resolved against declarations that
+ * existed then, so added ones can't change their outcome; a removed or
+ * changed one can.
+ */
+static int declarations_kept(const IncUpdate *up, const Incremental *inc, size_t imports) {
+    if (!inc->unit || inc->stale || imports != inc->imports_hash) {
+        return 0;
+    }
+    for (size_t i = 0; i < inc->count; i++) {
+        const IncMember *m = &inc->members[i];
+        SymbolKind kind = m->member->kind == AST_METHOD ? SYM_METHOD : SYM_FIELD;
+        const Symbol *s = symbols_find(&up->symbols, kind, m->owner, m->name);
+        if (!s || signature_hash(s->decl) != signature_hash(m->member)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int grow(void **items, size_t len, size_t *cap, size_t elem) {
+    if (len < *cap) {
+        return 1;
+    }
+    size_t new_cap = *cap ? *cap * 2 : 16;
+    void *grown = realloc(*items, new_cap * elem);
+    if (!grown) {
+        return 0;
+    }
+    *items = grown;
+    *cap = new_cap;
+    return 1;
+}
+
+/* Declarations-only parse that records where each member starts and ends. */
+static Ast *scan_unit(Parser *ps, IncUpdate *up, Diag *diag) {
+    Ast *unit = parse_unit_begin(ps);
+    if (!unit || !unit->as.comp_unit.clazz) {
+        return NULL;
+    }
+    for (Ast *clazz = unit->as.comp_unit.clazz; clazz; clazz = clazz->next) {
+        if (!grow((void **)&up->classes, up->class_count, &up->class_cap, sizeof(IncClass))) {
+            diag_error(diag, clazz->tok.pos, "out of memory");
+            return NULL;
+        }
+        IncClass *c = &up->classes[up->class_count++];
+        c->clazz = clazz;
+        c->first = up->span_count;
+        c->changed = 0;
+        Ast *tail = NULL;
+        while (!diag->had_error) {
+            size_t start = ps->current.pos;
+            Ast *member = parse_next_member(ps);
+            if (!member) {
+                break;
+            }
+            if (!grow((void **)&up->spans, up->span_count, &up->span_cap, sizeof(IncSpan))) {
+                diag_error(diag, start, "out of memory");
+                return NULL;
+            }
+            IncSpan *span = &up->spans[up->span_count++];
+            span->decl = member;
+            span->start = start;
+            span->end = ps->last_end;
+            if (tail) {
+                tail->next = member;
+            } else {
+                clazz->as.class_decl.members = member;
+            }
+            tail = member;
+        }
+        c->count = up->span_count - c->first;
+        parse_class_end(ps);
+        clazz->next = parse_next_class(ps);
+    }
+    return diag->had_error ? NULL : unit;
+}
+
+static int build_table(IncUpdate *up, const Incremental *inc) {
+    size_t cap = 16;
+    while (cap < inc->count * 2) {
+        cap *= 2;
+    }
+    up->table = (size_t *)calloc(cap, sizeof(size_t));
+    if (!up->table) {
+        return 0;
+    }
+    up->table_cap = cap;
+    for (size_t i = 0; i < inc->count; i++) {
+        const IncMember *m = &inc->members[i];
+        size_t slot = member_key(m->owner, m->name) & (cap - 1);
+        while (up->table[slot]) {
+            slot = (slot + 1) & (cap - 1);
+        }
+        up->table[slot] = i + 1;
+    }
+    return 1;
+}
+
+static IncMember *find_previous(const IncUpdate *up, Incremental *inc, Str owner, Str name) {
+    if (!up->table) {
+        return NULL;
+    }
+    size_t slot = member_key(owner, name) & (up->table_cap - 1);
+    for (; up->table[slot]; slot = (slot + 1) & (up->table_cap - 1)) {
+        IncMember *m = &inc->members[up->table[slot] - 1];
+        if (str_eq(m->owner, owner) && str_eq(m->name, name)) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+/* Parses one member again from a copy of its span, owned by this update's generation. */
+static int reparse_member(IncUpdate *up, const IncClass *c, const IncSpan *span, IncMember *m, Diag *diag) {
+    if (!up->gen) {
+        up->gen = (IncGeneration *)calloc(1, sizeof(IncGeneration));
+        if (!up->gen) {
+            diag_error(diag, span->start, "out of memory");
+            return 0;
+        }
+        arena_init(&up->gen->arena);
+    }
+    Arena *arena = &up->gen->arena;
+    size_t len = span->end - span->start;
+    Str owner = c->clazz->as.class_decl.name;
+    char *text = (char *)arena_alloc(arena, len + 1);
+    char *owner_text = (char *)arena_alloc(arena, owner.len + 1);
+    if (!text || !owner_text) {
+        diag_error(diag, span->start, "out of memory");
+        return 0;
+    }
+    memcpy(text, up->src + span->start, len);
+    memcpy(owner_text, owner.data, owner.len);
+
+    Parser ps;
+    parser_init_span(&ps, text, len, span->start, diag, arena);
+    Ast *member = parse_next_member(&ps);
+    parser_free(&ps);
+    if (!member) {
+        return 0;
+    }
+    m->owner.data = owner_text;
+    m->owner.len = owner.len;
+    m->name = member_name(member);
+    m->text = text;
+    m->len = len;
+    m->member = member;
+    m->gen = up->gen;
+    up->gen->live++;
+    return !diag->had_error;
+}
+
+static void update_discard(IncUpdate *up, Incremental *inc) {
+    for (size_t i = 0; i < inc->count; i++) {
+        inc->members[i].claimed = 0;
+    }
+    if (up->gen) {
+        arena_free(&up->gen->arena);
+        free(up->gen);
+    }
+    free(up->members);
+    symbols_free(&up->symbols);
+    arena_free(&up->decl_arena);
+    free(up->src);
+    free(up->classes);
+    free(up->spans);
+    free(up->table);
+}
+
+static void release_member(Incremental *inc, IncMember *m) {
+    if (m->artifact && inc->hooks && inc->hooks->free_artifact) {
+        inc->hooks->free_artifact(m->artifact, inc->hooks->user);
+    }
+    m->artifact = NULL;
+    if (m->gen) {
+        m->gen->live--;
+    }
+}
+
+static void sweep_generations(Incremental *inc) {
+    IncGeneration **link = &inc->generations;
+    while (*link) {
+        IncGeneration *gen = *link;
+        if (gen->live) {
+            link = &gen->next;
+            continue;
+        }
+        *link = gen->next;
+        arena_free(&gen->arena);
+        free(gen);
+    }
+}
+
+static void emit_classes(IncUpdate *up, Incremental *inc) {
+    const IncrementalHooks *hooks = inc->hooks;
+    void **artifacts = NULL;
+    size_t artifacts_cap = 0;
+    for (size_t k = 0; k < up->class_count; k++) {
+        IncClass *c = &up->classes[k];
+        if (!c->changed) {
+            continue;
+        }
+        for (size_t i = c->first; i < c->first + c->count; i++) {
+            IncMember *m = &up->members[i];
+            if (m->gen == up->gen && hooks->emit_member) {
+                hooks->emit_member(c->clazz, m->member, &m->artifact, hooks->user);
+            }
+        }
+        if (!hooks->end_class) {
+            continue;
+        }
+        if (c->count > artifacts_cap) {
+            void **grown = (void **)realloc(artifacts, c->count * sizeof(void *));
+            if (!grown) {
+                continue;
+            }
+            artifacts = grown;
+            artifacts_cap = c->count;
+        }
+        for (size_t i = 0; i < c->count; i++) {
+            artifacts[i] = up->members[c->first + i].artifact;
+        }
+        hooks->end_class(c->clazz, (void *const *)artifacts, c->count, hooks->user);
+        inc->stats.classes_emitted++;
+    }
+    free(artifacts);
+}
+
+void incremental_init(Incremental *inc, const IncrementalHooks *hooks) {
+    memset(inc, 0, sizeof(*inc));
+    inc->hooks = hooks;
+    arena_init(&inc->decl_arena);
+    symbols_init(&inc->symbols);
+}
+
+void incremental_free(Incremental *inc) {
+    for (size_t i = 0; i < inc->count; i++) {
+        release_member(inc, &inc->members[i]);
+    }
+    sweep_generations(inc);
+    free(inc->members);
+    symbols_free(&inc->symbols);
+    arena_free(&inc->decl_arena);
+    free(inc->src);
+    memset(inc, 0, sizeof(*inc));
+}
+
+void incremental_invalidate(Incremental *inc) {
+    inc->stale = 1;
+}
+
+int incremental_update(Incremental *inc, const char *path, const char *src, size_t len, const SymbolIndex *project,
+                       Diag *diag) {
+    memset(&inc->stats, 0, sizeof(inc->stats));
+    IncUpdate up;
+    memset(&up, 0, sizeof(up));
+    arena_init(&up.decl_arena);
+    symbols_init(&up.symbols);
+    up.symbols.parent = project;
+
+    up.src = (char *)malloc(len + 1);
+    if (!up.src) {
+        diag_error(diag, 0, "out of memory");
+        return 0;
+    }
+    memcpy(up.src, src, len);
+    up.src[len] = '\0';
+
+    Parser ps;
+    parser_init(&ps, up.src, len, diag, &up.decl_arena);
+    ps.skip_bodies = 1;
+    up.unit = scan_unit(&ps, &up, diag);
+    parser_free(&ps);
+    if (!up.unit || !symbols_add_unit(&up.symbols, up.unit, path, diag)) {
+        update_discard(&up, inc);
+        return 0;
+    }
+
+    /* Without a previous member to look up, every member is reparsed. */
+    size_t imports = imports_hash(up.unit);
+    if (declarations_kept(&up, inc, imports) && !build_table(&up, inc)) {
+        diag_error(diag, 0, "out of memory");
+        update_discard(&up, inc);
+        return 0;
+    }
+    up.members = (IncMember *)calloc(up.span_count ? up.span_count : 1, sizeof(IncMember));
+    if (!up.members) {
+        diag_error(diag, 0, "out of memory");
+        update_discard(&up, inc);
+        return 0;
+    }
+
+    for (size_t k = 0; k < up.class_count; k++) {
+        IncClass *c = &up.classes[k];
+        for (size_t i = c->first; i < c->first + c->count; i++) {
+            const IncSpan *span = &up.spans[i];
+            IncMember *m = &up.members[i];
+            const char *text = up.src + span->start;
+            size_t span_len = span->end - span->start;
+            size_t hash = (size_t)hash_bytes(FNV_OFFSET, text, span_len);
+            IncMember *prev = find_previous(&up, inc, c->clazz->as.class_decl.name, member_name(span->decl));
+            if (prev && !prev->claimed && prev->hash == hash && prev->len == span_len &&
+                memcmp(prev->text, text, span_len) == 0) {
+                *m = *prev;
+                prev->claimed = 1;
+                m->claimed = 0;
+                if (m->index != i - c->first) {
+                    c->changed = 1;
+                }
+                m->index = i - c->first;
+                inc->stats.reused++;
+                continue;
+            }
+            m->hash = hash;
+            m->index = i - c->first;
+            c->changed = 1;
+            inc->stats.reparsed++;
+            if (reparse_member(&up, c, span, m, diag)) {
+                type_check_member(c->clazz, m->member, &up.symbols, diag);
+            }
+        }
+    }
+    if (diag->had_error) {
+        update_discard(&up, inc);
+        return 0;
+    }
+
+    /* A class that lost a member has to be emitted without it. */
+    for (size_t i = 0; i < inc->count; i++) {
+        const IncMember *prev = &inc->members[i];
+        if (prev->claimed) {
+            continue;
+        }
+        for (size_t k = 0; k < up.class_count; k++) {
+            if (str_eq(up.classes[k].clazz->as.class_decl.name, prev->owner)) {
+                up.classes[k].changed = 1;
+            }
+        }
+    }
+
+    /* The classes now hold the live members instead of their declarations. */
+    for (size_t k = 0; k < up.class_count; k++) {
+        IncClass *c = &up.classes[k];
+        Ast **link = &c->clazz->as.class_decl.members;
+        for (size_t i = c->first; i < c->first + c->count; i++) {
+            *link = up.members[i].member;
+            link = &up.members[i].member->next;
+        }
+        *link = NULL;
+    }
+
+    inc->stats.members = up.span_count;
+    if (inc->hooks) {
+        emit_classes(&up, inc);
+    }
+
+    for (size_t i = 0; i < inc->count; i++) {
+        if (!inc->members[i].claimed) {
+            release_member(inc, &inc->members[i]);
+        }
+    }
+    if (up.gen) {
+        up.gen->next = inc->generations;
+        inc->generations = up.gen;
+    }
+    sweep_generations(inc);
+    free(inc->members);
+    symbols_free(&inc->symbols);
+    arena_free(&inc->decl_arena);
+    free(inc->src);
+    inc->members = up.members;
+    inc->count = up.span_count;
+    inc->src = up.src;
+    inc->decl_arena = up.decl_arena;
+    inc->unit = up.unit;
+    inc->imports_hash = imports;
+    inc->symbols = up.symbols;
+    inc->stale = 0;
+    free(up.classes);
+    free(up.spans);
+    free(up.table);
+    return 1;
+}
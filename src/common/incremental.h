@@ -0,0 +1,87 @@
+#ifndef TINYJVM_INCREMENTAL_H
+#define TINYJVM_INCREMENTAL_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+#include "diag.h"
+#include "symbols.h"
+
+/*
+ * Recompiles one file for watch mode in proportion to the edit. Each update
+ * runs the declarations-only parse over the new source, takes the span of
+ * every member from it and hashes the span. A member whose text is unchanged
+ * keeps its AST and the artifact emit_member made for it; the rest are
+ * reparsed from their own span and checked against the new declarations.
+ * end_class then runs only for classes with a new, changed, removed or
+ * moved member.
+ *
+ * Removing or changing a declaration (an import, field or signature) can
+ * change how unchanged bodies check, so it reparses every member; adding
+ * one can't, since the previous bodies all checked cleanly. Reused
+ * members keep the source positions they were parsed at. An update that
+ * reports an error leaves the state of the last clean update in place.
+ *
+ * Calls and types resolve against the file's new declarations first and
+ * then the project index, which may still hold this file's old ones: a
+ * class the file declares hides the project's entries for it. Checking
+ * that the project has a main method is left to the driver, as with
+ * pipeline_compile. When other files' declarations change, the driver
+ * calls incremental_invalidate so that the next update rechecks everything.
+ */
+typedef struct {
+    void (*emit_member)(Ast *clazz, Ast *member, void **artifact, void *user);
+    void (*free_artifact)(void *artifact, void *user);
+    /* artifacts are those of clazz's members, in member order. */
+    void (*end_class)(Ast *clazz, void *const *artifacts, size_t count, void *user);
+    void *user;
+} IncrementalHooks;
+
+typedef struct {
+    size_t members;
+    size_t reused;
+    size_t reparsed;
+    size_t classes_emitted;
+} IncrementalStats;
+
+typedef struct IncGeneration IncGeneration;
+
+typedef struct {
+    Str owner;
+    Str name;
+    size_t hash;
+    const char *text; /* the member's source span */
+    size_t len;
+    size_t index;     /* position within its class */
+    Ast *member;
+    void *artifact;
+    IncGeneration *gen; /* owns text and member */
+    int claimed;
+} IncMember;
+
+typedef struct {
+    const IncrementalHooks *hooks;
+    IncMember *members;
+    size_t count;
+    IncGeneration *generations;
+    char *src;
+    Arena decl_arena;
+    Ast *unit; /* the declarations, with the live member ASTs on each class */
+    size_t imports_hash;
+    SymbolIndex symbols;
+    int stale; /* set by incremental_invalidate */
+    IncrementalStats stats;
+} Incremental;
+
+void incremental_init(Incremental *inc, const IncrementalHooks *hooks);
+void incremental_free(Incremental *inc);
+
+/*
+ * diag must be set up for src; returns 0 when the update reported errors.
+ * project may be NULL for a file that stands alone.
+ */
+int incremental_update(Incremental *inc, const char *path, const char *src, size_t len, const SymbolIndex *project,
+                       Diag *diag);
+void incremental_invalidate(Incremental *inc);
+
+#endif
@@ -0,0 +1,553 @@
+#include "inline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Same limit as the type checker's local table. */
+#define INLINE_MAX_LOCALS 256
+#define INLINE_MAX_BINDINGS 64
+
+typedef enum {
+    HELPER_NONE,
+    HELPER_EXPR,
+    HELPER_VOID
+} HelperKind;
+
+/* A callee name inside the cloned body: either replaced by expr or renamed to `to`. */
+typedef struct {
+    Str name;
+    Ast *expr;
+    Str to;
+} Binding;
+
+typedef struct {
+    Binding items[INLINE_MAX_BINDINGS];
+    int count;
+} Bindings;
+
+typedef struct {
+    Arena *arena;
+    Ast *clazz;
+    const InlineOptions *opts;
+    size_t inlined;
+    size_t next_id;
+    int locals;
+    int oom;
+} InlineCtx;
+
+typedef struct {
+    Str name;
+    int uses;
+    int assigned;
+} NameUse;
+
+void inline_options_default(InlineOptions *opts) {
+    opts->max_nodes = 32;
+    opts->max_rounds = 4;
+}
+
+static int find_user_call(Ast *node, void *user) {
+    (void)user;
+    return node->kind == AST_CALL && !str_eq_c(node->as.call.callee, "System.out.println");
+}
+
+static int find_return(Ast *node, void *user) {
+    (void)user;
+    return node->kind == AST_RETURN;
+}
+
+static int count_decl(Ast *node, void *user) {
+    if (node->kind == AST_VAR_DECL) {
+        (*(int *)user)++;
+    }
+    return 0;
+}
+
+static int count_use(Ast *node, void *user) {
+    NameUse *u = (NameUse *)user;
+    if (node->kind == AST_IDENT && str_eq(node->as.ident.name, u->name)) {
+        u->uses++;
+    } else if (node->kind == AST_ASSIGN && str_eq(node->as.assign.name, u->name)) {
+        u->assigned = 1;
+    } else if (node->kind == AST_INC && str_eq(node->as.inc.name, u->name)) {
+        u->assigned = 1;
+    }
+    return 0;
+}
+
+static NameUse name_use(Ast *body, Str name) {
+    NameUse u = {name, 0, 0};
+    ast_visit(body, count_use, &u);
+    return u;
+}
+
+static int count_params(Ast *method) {
+    int n = 0;
+    for (Ast *param = method->as.method_decl.params; param; param = param->next) {
+        n++;
+    }
+    return n;
+}
+
+/* Statement-only walk so that large expressions in the caller aren't visited. */
+static int count_locals(Ast *stmt) {
+    int n = 0;
+    for (; stmt; stmt = stmt->next) {
+        switch (stmt->kind) {
+            case AST_VAR_DECL:
+                n++;
+                break;
+            case AST_BLOCK:
+                n += count_locals(stmt->as.block.stmts);
+                break;
+            case AST_IF:
+                n += count_locals(stmt->as.if_stmt.then_branch);
+                n += count_locals(stmt->as.if_stmt.else_branch);
+                break;
+            case AST_WHILE:
+                n += count_locals(stmt->as.while_stmt.body);
+                break;
+            case AST_FOR:
+                n += count_locals(stmt->as.for_stmt.init);
+                n += count_locals(stmt->as.for_stmt.body);
+                break;
+            default:
+                break;
+        }
+    }
+    return n;
+}
+
+static HelperKind helper_kind(InlineCtx *ctx, Ast *method) {
+    if (!method || !method->as.method_decl.is_static || !method->as.method_decl.body) {
+        return HELPER_NONE;
+    }
+    Ast *body = method->as.method_decl.body;
+    if (ast_count_nodes(body, ctx->opts->max_nodes) > ctx->opts->max_nodes) {
+        return HELPER_NONE;
+    }
+    if (ast_visit(body, find_user_call, NULL)) {
+        return HELPER_NONE;
+    }
+    int decls = 0;
+    ast_visit(body, count_decl, &decls);
+    if (decls + count_params(method) > INLINE_MAX_BINDINGS) {
+        return HELPER_NONE;
+    }
+    Ast *stmts = body->as.block.stmts;
+    if (!str_eq_c(method->as.method_decl.ret_type, "void")) {
+        if (stmts && !stmts->next && stmts->kind == AST_RETURN && stmts->as.return_stmt.expr) {
+            return HELPER_EXPR;
+        }
+        return HELPER_NONE;
+    }
+    for (Ast *stmt = stmts; stmt; stmt = stmt->next) {
+        if (stmt->kind == AST_RETURN && !stmt->next) {
+            break;
+        }
+        if (ast_visit(stmt, find_return, NULL)) {
+            return HELPER_NONE;
+        }
+    }
+    return HELPER_VOID;
+}
+
+static int is_leaf(Ast *expr) {
+    return expr->kind == AST_INT_LIT || expr->kind == AST_STRING_LIT || expr->kind == AST_IDENT;
+}
+
+static Binding *bindings_find(Bindings *b, Str name) {
+    if (!b) return NULL;
+    for (int i = b->count - 1; i >= 0; i--) {
+        if (str_eq(b->items[i].name, name)) {
+            return &b->items[i];
+        }
+    }
+    return NULL;
+}
+
+static void bindings_add(Bindings *b, Str name, Ast *expr, Str to) {
+    b->items[b->count].name = name;
+    b->items[b->count].expr = expr;
+    b->items[b->count].to = to;
+    b->count++;
+}
+
+static Str fresh_name(InlineCtx *ctx, Str base) {
+    char suffix[32];
+    int n = snprintf(suffix, sizeof(suffix), "$%zu", ctx->next_id++);
+    Str out = {NULL, 0};
+    char *data = (char *)arena_alloc(ctx->arena, base.len + (size_t)n);
+    if (!data) {
+        ctx->oom = 1;
+        return out;
+    }
+    memcpy(data, base.data, base.len);
+    memcpy(data + base.len, suffix, (size_t)n);
+    out.data = data;
+    out.len = base.len + (size_t)n;
+    return out;
+}
+
+static Ast *new_node(InlineCtx *ctx, AstKind kind, Token tok) {
+    Ast *node = (Ast *)arena_alloc(ctx->arena, sizeof(Ast));
+    if (!node) {
+        ctx->oom = 1;
+        return NULL;
+    }
+    node->kind = kind;
+    node->tok = tok;
+    return node;
+}
+
+static Ast *clone_node(InlineCtx *ctx, Ast *node, Bindings *b);
+
+static Ast *clone_root(InlineCtx *ctx, Ast *node, Bindings *b) {
+    Ast *copy = clone_node(ctx, node, b);
+    if (copy && !ast_rebuild_post(ctx->arena, copy)) {
+        ctx->oom = 1;
+    }
+    return copy;
+}
+
+static Ast *clone_chain(InlineCtx *ctx, Ast *node, Bindings *b, int roots) {
+    Ast *head = NULL;
+    Ast **tail = &head;
+    for (; node; node = node->next) {
+        *tail = roots ? clone_root(ctx, node, b) : clone_node(ctx, node, b);
+        if (!*tail) break;
+        tail = &(*tail)->next;
+    }
+    return head;
+}
+
+/*
+ * Copies a callee subtree, applying the bindings. Bound expressions are
+ * leaves or used exactly once, so they are copied shallowly or moved.
+ */
+static Ast *clone_node(InlineCtx *ctx, Ast *node, Bindings *b) {
+    if (!node) return NULL;
+    Binding *bound = NULL;
+    if (node->kind == AST_IDENT) {
+        bound = bindings_find(b, node->as.ident.name);
+        if (bound && bound->expr && !is_leaf(bound->expr)) {
+            return bound->expr;
+        }
+        if (bound && bound->expr) {
+            node = bound->expr;
+            bound = NULL;
+        }
+    }
+    Ast *copy = (Ast *)arena_alloc(ctx->arena, sizeof(Ast));
+    if (!copy) {
+        ctx->oom = 1;
+        return NULL;
+    }
+    *copy = *node;
+    copy->next = NULL;
+    switch (node->kind) {
+        case AST_IDENT:
+            if (bound) copy->as.ident.name = bound->to;
+            break;
+        case AST_BLOCK:
+            copy->as.block.stmts = clone_chain(ctx, node->as.block.stmts, b, 0);
+            break;
+        case AST_RETURN:
+            copy->as.return_stmt.expr = clone_root(ctx, node->as.return_stmt.expr, b);
+            break;
+        case AST_IF:
+            copy->as.if_stmt.cond = clone_root(ctx, node->as.if_stmt.cond, b);
+            copy->as.if_stmt.then_branch = clone_node(ctx, node->as.if_stmt.then_branch, b);
+            copy->as.if_stmt.else_branch = clone_node(ctx, node->as.if_stmt.else_branch, b);
+            break;
+        case AST_WHILE:
+            copy->as.while_stmt.cond = clone_root(ctx, node->as.while_stmt.cond, b);
+            copy->as.while_stmt.body = clone_node(ctx, node->as.while_stmt.body, b);
+            break;
+        case AST_FOR:
+            copy->as.for_stmt.init = clone_node(ctx, node->as.for_stmt.init, b);
+            copy->as.for_stmt.cond = clone_root(ctx, node->as.for_stmt.cond, b);
+            copy->as.for_stmt.update = clone_node(ctx, node->as.for_stmt.update, b);
+            copy->as.for_stmt.body = clone_node(ctx, node->as.for_stmt.body, b);
+            break;
+        case AST_VAR_DECL:
+            copy->as.var_decl.init = clone_root(ctx, node->as.var_decl.init, b);
+            copy->as.var_decl.name = fresh_name(ctx, node->as.var_decl.name);
+            bindings_add(b, node->as.var_decl.name, NULL, copy->as.var_decl.name);
+            break;
+        case AST_EXPR_STMT:
+            copy->as.expr_stmt.expr = clone_root(ctx, node->as.expr_stmt.expr, b);
+            break;
+        case AST_ASSIGN:
+            bound = bindings_find(b, node->as.assign.name);
+            if (bound) copy->as.assign.name = bound->to;
+            copy->as.assign.value = clone_root(ctx, node->as.assign.value, b);
+            break;
+        case AST_INC:
+            bound = bindings_find(b, node->as.inc.name);
+            if (bound) copy->as.inc.name = bound->to;
+            break;
+        case AST_BIN:
+            copy->as.bin.lhs = clone_node(ctx, node->as.bin.lhs, b);
+            copy->as.bin.rhs = clone_node(ctx, node->as.bin.rhs, b);
+            copy->as.bin.post = NULL;
+            copy->as.bin.post_len = 0;
+            break;
+        case AST_CALL:
+            copy->as.call.args = clone_chain(ctx, node->as.call.args, b, 1);
+            break;
+        default:
+            break;
+    }
+    return copy;
+}
+
+static void detach_args(Ast *call) {
+    Ast *arg = call->as.call.args;
+    while (arg) {
+        Ast *next = arg->next;
+        arg->next = NULL;
+        arg = next;
+    }
+}
+
+static Ast *inline_expr_call(InlineCtx *ctx, Ast *call, Ast *method) {
+    Ast *ret = method->as.method_decl.body->as.block.stmts->as.return_stmt.expr;
+    Bindings b;
+    b.count = 0;
+    Ast *param = method->as.method_decl.params;
+    Ast *arg = call->as.call.args;
+    for (; param && arg; param = param->next, arg = arg->next) {
+        NameUse u = name_use(ret, param->as.var_decl.name);
+        if (!ast_is_pure(arg) || (u.uses > 1 && !is_leaf(arg))) {
+            return call;
+        }
+        bindings_add(&b, param->as.var_decl.name, arg, param->as.var_decl.name);
+    }
+    detach_args(call);
+    Ast *result = clone_node(ctx, ret, &b);
+    if (!result) return call;
+    ctx->inlined++;
+    return result;
+}
+
+static Ast *inline_void_call(InlineCtx *ctx, Ast *stmt, Ast *call, Ast *method) {
+    Ast *body = method->as.method_decl.body;
+    int decls = 0;
+    ast_visit(body, count_decl, &decls);
+    if (ctx->locals + decls + count_params(method) > INLINE_MAX_LOCALS) {
+        return stmt;
+    }
+    Ast *block = new_node(ctx, AST_BLOCK, stmt->tok);
+    if (!block) return stmt;
+    Ast **tail = &block->as.block.stmts;
+
+    Bindings b;
+    b.count = 0;
+    Ast *param = method->as.method_decl.params;
+    Ast *arg = call->as.call.args;
+    detach_args(call);
+    for (; param && arg; param = param->next) {
+        Ast *next = arg->next;
+        Str name = param->as.var_decl.name;
+        NameUse u = name_use(body, name);
+        if (!u.assigned && is_leaf(arg)) {
+            bindings_add(&b, name, arg, name);
+        } else {
+            Ast *temp = new_node(ctx, AST_VAR_DECL, arg->tok);
+            if (!temp) return stmt;
+            temp->as.var_decl.name = fresh_name(ctx, name);
+            temp->as.var_decl.type = param->as.var_decl.type;
+            temp->as.var_decl.init = arg;
+            bindings_add(&b, name, NULL, temp->as.var_decl.name);
+            *tail = temp;
+            tail = &temp->next;
+            ctx->locals++;
+        }
+        arg = next;
+    }
+    for (Ast *s = body->as.block.stmts; s; s = s->next) {
+        if (s->kind == AST_RETURN) {
+            break;
+        }
+        *tail = clone_node(ctx, s, &b);
+        if (!*tail) return stmt;
+        tail = &(*tail)->next;
+    }
+    ctx->locals += decls;
+    ctx->inlined++;
+    return block;
+}
+
+static Ast *inline_expr(InlineCtx *ctx, Ast *expr);
+
+/* Rewrites the expression in *slot, keeping its place in an argument list. */
+static void inline_slot(InlineCtx *ctx, Ast **slot) {
+    if (!*slot) return;
+    size_t before = ctx->inlined;
+    Ast *next = (*slot)->next;
+    *slot = inline_expr(ctx, *slot);
+    if (ctx->inlined != before) {
+        (*slot)->next = next;
+        if (!ast_rebuild_post(ctx->arena, *slot)) {
+            ctx->oom = 1;
+        }
+    }
+}
+
+static void inline_args(InlineCtx *ctx, Ast *call) {
+    for (Ast **arg = &call->as.call.args; *arg; arg = &(*arg)->next) {
+        inline_slot(ctx, arg);
+    }
+}
+
+/*
+ * Calls inside a binary expression are operands in its post-order slice, so
+ * they can be replaced without recursing: each operator finds its rhs just
+ * before it and its lhs just before the rhs subtree.
+ */
+static Ast *inline_bin(InlineCtx *ctx, Ast *expr) {
+    if (!expr->as.bin.post) {
+        expr->as.bin.lhs = inline_expr(ctx, expr->as.bin.lhs);
+        expr->as.bin.rhs = inline_expr(ctx, expr->as.bin.rhs);
+        return expr;
+    }
+    Ast **post = expr->as.bin.post;
+    size_t n = expr->as.bin.post_len;
+    size_t i = 0;
+    while (i < n && post[i]->kind != AST_CALL) {
+        i++;
+    }
+    if (i == n) return expr;
+
+    Ast **repl = (Ast **)malloc(n * sizeof(Ast *));
+    if (!repl) {
+        ctx->oom = 1;
+        return expr;
+    }
+    for (i = 0; i < n; i++) {
+        Ast *node = post[i];
+        if (node->kind != AST_BIN) {
+            repl[i] = node->kind == AST_CALL ? inline_expr(ctx, node) : node;
+            continue;
+        }
+        Ast *rhs = node->as.bin.rhs;
+        size_t rhs_len = rhs->kind == AST_BIN ? rhs->as.bin.post_len : 1;
+        node->as.bin.rhs = repl[i - 1];
+        node->as.bin.lhs = repl[i - 1 - rhs_len];
+        repl[i] = node;
+    }
+    free(repl);
+    return expr;
+}
+
+static Ast *inline_expr(InlineCtx *ctx, Ast *expr) {
+    if (!expr || ctx->oom) return expr;
+    if (expr->kind == AST_BIN) {
+        return inline_bin(ctx, expr);
+    }
+    if (expr->kind != AST_CALL) {
+        return expr;
+    }
+    inline_args(ctx, expr);
+    Ast *method = ast_find_method(ctx->clazz, expr->as.call.callee);
+    if (helper_kind(ctx, method) == HELPER_EXPR) {
+        return inline_expr_call(ctx, expr, method);
+    }
+    return expr;
+}
+
+/* allow_block is off where only a simple statement may stand (for init/update). */
+static void inline_stmt(InlineCtx *ctx, Ast **slot, int allow_block) {
+    Ast *stmt = *slot;
+    if (!stmt || ctx->oom) return;
+    switch (stmt->kind) {
+        case AST_VAR_DECL:
+            inline_slot(ctx, &stmt->as.var_decl.init);
+            break;
+        case AST_EXPR_STMT: {
+            Ast *call = stmt->as.expr_stmt.expr;
+            if (call->kind != AST_CALL) {
+                inline_slot(ctx, &stmt->as.expr_stmt.expr);
+                break;
+            }
+            inline_args(ctx, call);
+            Ast *method = ast_find_method(ctx->clazz, call->as.call.callee);
+            if (allow_block && helper_kind(ctx, method) == HELPER_VOID) {
+                Ast *block = inline_void_call(ctx, stmt, call, method);
+                block->next = stmt->next;
+                *slot = block;
+            }
+        } break;
+        case AST_ASSIGN:
+            inline_slot(ctx, &stmt->as.assign.value);
+            break;
+        case AST_RETURN:
+            inline_slot(ctx, &stmt->as.return_stmt.expr);
+            break;
+        case AST_BLOCK:
+            for (Ast **s = &stmt->as.block.stmts; *s; s = &(*s)->next) {
+                inline_stmt(ctx, s, 1);
+            }
+            break;
+        case AST_IF:
+            inline_slot(ctx, &stmt->as.if_stmt.cond);
+            inline_stmt(ctx, &stmt->as.if_stmt.then_branch, 1);
+            inline_stmt(ctx, &stmt->as.if_stmt.else_branch, 1);
+            break;
+        case AST_WHILE:
+            inline_slot(ctx, &stmt->as.while_stmt.cond);
+            inline_stmt(ctx, &stmt->as.while_stmt.body, 1);
+            break;
+        case AST_FOR:
+            inline_stmt(ctx, &stmt->as.for_stmt.init, 0);
+            inline_slot(ctx, &stmt->as.for_stmt.cond);
+            inline_stmt(ctx, &stmt->as.for_stmt.update, 0);
+            inline_stmt(ctx, &stmt->as.for_stmt.body, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+int inline_static_calls(Ast *comp_unit, Arena *arena, const InlineOptions *opts, InlineStats *stats) {
+    InlineOptions defaults;
+    if (!opts) {
+        inline_options_default(&defaults);
+        opts = &defaults;
+    }
+    stats->calls_inlined = 0;
+    stats->rounds = 0;
+    if (!comp_unit || !comp_unit->as.comp_unit.clazz) {
+        return 1;
+    }
+
+    InlineCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.arena = arena;
+    ctx.opts = opts;
+
+    /* Helpers are only looked up in the caller's own class. */
+    for (int round = 0; round < opts->max_rounds; round++) {
+        size_t before = ctx.inlined;
+        for (ctx.clazz = comp_unit->as.comp_unit.clazz; ctx.clazz; ctx.clazz = ctx.clazz->next) {
+            for (Ast *member = ctx.clazz->as.class_decl.members; member; member = member->next) {
+                if (member->kind != AST_METHOD || !member->as.method_decl.body) {
+                    continue;
+                }
+                ctx.locals = count_params(member) + count_locals(member->as.method_decl.body);
+                inline_stmt(&ctx, &member->as.method_decl.body, 1);
+                if (ctx.oom) {
+                    return 0;
+                }
+            }
+        }
+        stats->rounds++;
+        if (ctx.inlined == before) {
+            break;
+        }
+    }
+    stats->calls_inlined = ctx.inlined;
+    return 1;
+}
@@ -0,0 +1,31 @@
+#ifndef TINYJVM_INLINE_H
+#define TINYJVM_INLINE_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+
+/*
+ * Substitutes the bodies of small static helpers at their call sites, on a
+ * checked AST before emission. A helper qualifies when its body fits in
+ * max_nodes and calls no user methods, which also rules out recursion.
+ * Helpers whose own calls were inlined qualify on the next round.
+ *
+ * Non-void helpers must be a single `return expr;` and are inlined wherever
+ * the call appears. Void helpers are inlined at statement level as a block,
+ * with arguments bound to fresh locals unless they are literals or locals.
+ */
+typedef struct {
+    size_t max_nodes;
+    int max_rounds;
+} InlineOptions;
+
+typedef struct {
+    size_t calls_inlined;
+    int rounds;
+} InlineStats;
+
+void inline_options_default(InlineOptions *opts);
+int inline_static_calls(Ast *comp_unit, Arena *arena, const InlineOptions *opts, InlineStats *stats);
+
+#endif
@@ -1,7 +1,25 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "lexer.h"
 
 #include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+/* -DLEXER_NO_SIMD builds the portable word-at-a-time scan instead. */
+#if defined(__SSE2__) && !defined(LEXER_NO_SIMD)
+#define LEXER_SSE2 1
+#include <emmintrin.h>
+#else
+#define LEXER_SSE2 0
+#endif
+
+#ifndef LEXER_CHUNK
+#define LEXER_CHUNK (64 * 1024)
+#endif
 
 static int is_ident_start(int c) {
     return isalpha(c) || c == '_';
@@ -11,12 +29,269 @@ static int is_ident_part(int c) {
     return isalnum(c) || c == '_';
 }
 
+typedef struct {
+    uint32_t lo;
+    uint32_t hi;
+} CodeRange;
+
+/*
+ * Code points above Latin-1 that Character.isJavaIdentifierPart rejects:
+ * spaces, punctuation and symbols, with the letters, marks, currency signs
+ * and connectors inside those blocks left out. Everything else is taken as
+ * a letter, which keeps `a≠b` three tokens without carrying the full
+ * Unicode category tables.
+ */
+static const CodeRange non_ident_ranges[] = {
+    {0x037E, 0x037E}, {0x0387, 0x0387}, {0x055A, 0x055F}, {0x0589, 0x058A},
+    {0x05BE, 0x05BE}, {0x05C0, 0x05C0}, {0x05C3, 0x05C3}, {0x05C6, 0x05C6},
+    {0x05F3, 0x05F4}, {0x0606, 0x060A}, {0x060C, 0x060F}, {0x061B, 0x061B},
+    {0x061D, 0x061F}, {0x066A, 0x066D}, {0x06D4, 0x06D4}, {0x0964, 0x0965},
+    {0x0970, 0x0970}, {0x0E4F, 0x0E4F}, {0x0E5A, 0x0E5B}, {0x1680, 0x1680},
+    {0x1800, 0x180A}, {0x2000, 0x200A}, {0x2010, 0x2029}, {0x202F, 0x203E},
+    {0x2041, 0x2053}, {0x2055, 0x205F}, {0x2065, 0x2065}, {0x2070, 0x2070},
+    {0x2072, 0x207E}, {0x2080, 0x208F}, {0x209D, 0x209F}, {0x20C1, 0x20CF},
+    {0x20DD, 0x20E0}, {0x20E2, 0x20E4}, {0x20F1, 0x2101}, {0x2103, 0x2106},
+    {0x2108, 0x2109}, {0x2114, 0x2114}, {0x2116, 0x2118}, {0x211E, 0x2123},
+    {0x2125, 0x2125}, {0x2127, 0x2127}, {0x2129, 0x2129}, {0x212E, 0x212E},
+    {0x213A, 0x213B}, {0x2140, 0x2144}, {0x214A, 0x214D}, {0x214F, 0x215F},
+    {0x2189, 0x2BFF}, {0x2E00, 0x2E2E}, {0x2E30, 0x2FFF}, {0x3000, 0x3004},
+    {0x3008, 0x3020}, {0x3030, 0x3030}, {0x3036, 0x3037}, {0x303D, 0x303F},
+    {0xFD3E, 0xFD3F}, {0xFE10, 0xFE19}, {0xFE30, 0xFE32}, {0xFE35, 0xFE4C},
+    {0xFE50, 0xFE68}, {0xFE6A, 0xFE6F}, {0xFF00, 0xFF03}, {0xFF05, 0xFF0F},
+    {0xFF1A, 0xFF20}, {0xFF3B, 0xFF3E}, {0xFF40, 0xFF40}, {0xFF5B, 0xFF65},
+    {0xFFE2, 0xFFE4}, {0xFFE7, 0xFFEE}, {0xFFFC, 0xFFFF}, {0x1F000, 0x1FBEF},
+};
+
+static int in_ranges(const CodeRange *r, size_t n, uint32_t cp) {
+    size_t lo = 0;
+    size_t hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cp < r[mid].lo) {
+            hi = mid;
+        } else if (cp > r[mid].hi) {
+            lo = mid + 1;
+        } else {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Latin-1 is exact: letters, currency signs, and the C1 controls and soft
+ * hyphen that Java ignores inside identifiers. Above it, start and part
+ * aren't told apart.
+ */
+static int is_ident_code_point(uint32_t cp, int start) {
+    if (cp < 0x80) return start ? is_ident_start((int)cp) : is_ident_part((int)cp);
+    if (cp < 0x100) {
+        if (cp <= 0x9F || cp == 0xAD) return !start;
+        return cp == 0xAA || cp == 0xB5 || cp == 0xBA || (cp >= 0xA2 && cp <= 0xA5) ||
+               (cp >= 0xC0 && cp != 0xD7 && cp != 0xF7);
+    }
+    if (cp >= 0xD800 && cp <= 0xDFFF) return 0;
+    return !in_ranges(non_ident_ranges, sizeof(non_ident_ranges) / sizeof(non_ident_ranges[0]), cp);
+}
+
+/* Returns the length of the sequence at s, or 0 if it is malformed, overlong or a surrogate. */
+static size_t utf8_decode(const unsigned char *s, size_t avail, uint32_t *out) {
+    unsigned char b = s[0];
+    size_t n;
+    uint32_t cp;
+    uint32_t min;
+    if (b < 0x80) {
+        *out = b;
+        return 1;
+    }
+    if (b >= 0xC2 && b <= 0xDF) {
+        n = 2;
+        cp = b & 0x1F;
+        min = 0x80;
+    } else if ((b & 0xF0) == 0xE0) {
+        n = 3;
+        cp = b & 0x0F;
+        min = 0x800;
+    } else if (b >= 0xF0 && b <= 0xF4) {
+        n = 4;
+        cp = b & 0x07;
+        min = 0x10000;
+    } else {
+        return 0;
+    }
+    if (avail < n) return 0;
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return 0;
+    *out = cp;
+    return n;
+}
+
+/* Lone surrogates from \u escapes are kept as three-byte sequences. */
+static size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static int hex_value(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Parses \u+XXXX at s; returns its length, or 0 if s doesn't hold one. */
+static size_t unicode_escape_at(const char *s, size_t avail, uint32_t *cp) {
+    size_t i = 1;
+    while (i < avail && s[i] == 'u') i++;
+    if (i == 1 || avail < i + 4) return 0;
+    uint32_t v = 0;
+    for (size_t k = 0; k < 4; k++) {
+        int h = hex_value((unsigned char)s[i + k]);
+        if (h < 0) return 0;
+        v = (v << 4) | (uint32_t)h;
+    }
+    *cp = v;
+    return i + 4;
+}
+
+static int is_octal(int c) {
+    return c >= '0' && c <= '7';
+}
+
+/*
+ * Decodes a token body that the scanner already validated. The result is
+ * never longer than the source spelling, so out needs at most len bytes.
+ */
+static size_t decode_escapes(const char *s, size_t len, char *out) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i < len) {
+        if (s[i] != '\\') {
+            out[o++] = s[i++];
+            continue;
+        }
+        char e = s[i + 1];
+        uint32_t cp;
+        if (e == 'u') {
+            i += unicode_escape_at(s + i, len - i, &cp);
+            uint32_t low;
+            size_t n;
+            if (cp >= 0xD800 && cp <= 0xDBFF && i < len && s[i] == '\\' &&
+                (n = unicode_escape_at(s + i, len - i, &low)) && low >= 0xDC00 && low <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += n;
+            }
+            o += utf8_encode(cp, out + o);
+            continue;
+        }
+        if (is_octal((unsigned char)e)) {
+            size_t max = e <= '3' ? 3 : 2;
+            cp = 0;
+            i++;
+            for (size_t k = 0; k < max && i < len && is_octal((unsigned char)s[i]); k++, i++) {
+                cp = cp * 8 + (uint32_t)(s[i] - '0');
+            }
+            o += utf8_encode(cp, out + o);
+            continue;
+        }
+        switch (e) {
+            case 'b': out[o++] = '\b'; break;
+            case 't': out[o++] = '\t'; break;
+            case 'n': out[o++] = '\n'; break;
+            case 'f': out[o++] = '\f'; break;
+            case 'r': out[o++] = '\r'; break;
+            case 's': out[o++] = ' '; break;
+            default: out[o++] = e; break;
+        }
+        i += 2;
+    }
+    return o;
+}
+
+static const char *token_spelling(TokenType type) {
+    switch (type) {
+        case TOK_KW_CLASS: return "class";
+        case TOK_KW_PUBLIC: return "public";
+        case TOK_KW_STATIC: return "static";
+        case TOK_KW_IMPORT: return "import";
+        case TOK_KW_INT: return "int";
+        case TOK_KW_NEW: return "new";
+        case TOK_KW_RETURN: return "return";
+        case TOK_KW_VOID: return "void";
+        case TOK_KW_IF: return "if";
+        case TOK_KW_ELSE: return "else";
+        case TOK_KW_WHILE: return "while";
+        case TOK_KW_FOR: return "for";
+        case TOK_LBRACE: return "{";
+        case TOK_RBRACE: return "}";
+        case TOK_LPAREN: return "(";
+        case TOK_RPAREN: return ")";
+        case TOK_LBRACKET: return "[";
+        case TOK_RBRACKET: return "]";
+        case TOK_SEMI: return ";";
+        case TOK_COMMA: return ",";
+        case TOK_DOT: return ".";
+        case TOK_EQ: return "=";
+        case TOK_PLUS: return "+";
+        case TOK_PLUS_PLUS: return "++";
+        case TOK_MINUS: return "-";
+        case TOK_STAR: return "*";
+        case TOK_SLASH: return "/";
+        case TOK_PERCENT: return "%";
+        case TOK_EQ_EQ: return "==";
+        case TOK_BANG_EQ: return "!=";
+        case TOK_LT: return "<";
+        case TOK_LT_EQ: return "<=";
+        case TOK_GT: return ">";
+        case TOK_GT_EQ: return ">=";
+        default: return NULL;
+    }
+}
+
+/* The window will be recycled; keep fixed spellings static and copy the rest. */
+static void stream_token_text(Lexer *lx, Token *t) {
+    const char *spelling = token_spelling(t->type);
+    if (t->type == TOK_EOF) {
+        t->start = "";
+    } else if (spelling) {
+        t->start = spelling;
+    } else if (!lx->decoded) {
+        char *copy = (char *)arena_alloc(lx->arena, t->len + 1);
+        if (copy) {
+            memcpy(copy, t->start, t->len);
+        }
+        t->start = copy ? copy : "";
+        t->len = copy ? t->len : 0;
+    }
+}
+
 static Token make_token(Lexer *lx, TokenType type, size_t start, size_t end) {
     Token t;
     t.type = type;
     t.start = lx->src + start;
     t.len = end - start;
-    t.pos = start;
+    t.pos = lx->base + start;
     return t;
 }
 
@@ -37,6 +312,10 @@ static TokenType keyword_type(const char *s, size_t len) {
     if (match_kw(s, len, "new")) return TOK_KW_NEW;
     if (match_kw(s, len, "return")) return TOK_KW_RETURN;
     if (match_kw(s, len, "void")) return TOK_KW_VOID;
+    if (match_kw(s, len, "if")) return TOK_KW_IF;
+    if (match_kw(s, len, "else")) return TOK_KW_ELSE;
+    if (match_kw(s, len, "while")) return TOK_KW_WHILE;
+    if (match_kw(s, len, "for")) return TOK_KW_FOR;
     return TOK_IDENT;
 }
 
@@ -45,24 +324,276 @@ void lexer_init(Lexer *lx, const char *src, size_t len, Diag *diag) {
     lx->len = len;
     lx->pos = 0;
     lx->diag = diag;
+    lx->token_count = 0;
+    lx->base = 0;
+    lx->fd = -1;
+    lx->at_eof = 1;
+    lx->buf = NULL;
+    lx->cap = 0;
+    lx->keep = 0;
+    lx->arena = NULL;
+    lx->line = 1;
+    lx->line_start = 0;
+    lx->line_scan = 0;
+    lx->line_recorded = (size_t)-1;
+    lx->decoded = 0;
 }
 
-static void skip_ws_and_comments(Lexer *lx) {
+void lexer_init_fd(Lexer *lx, int fd, Diag *diag, Arena *arena) {
+    lexer_init(lx, NULL, 0, diag);
+    lx->fd = fd;
+    lx->at_eof = 0;
+    lx->arena = arena;
+    lx->src = "";
+}
+
+void lexer_free(Lexer *lx) {
+    free(lx->buf);
+    lx->buf = NULL;
+    lx->cap = 0;
+}
+
+/* Counts newlines in the window up to window index upto. */
+static void lexer_track_lines(Lexer *lx, size_t upto) {
+    size_t i = lx->line_scan - lx->base;
+    for (; i < upto; i++) {
+        if (lx->src[i] == '\n') {
+            lx->line++;
+            lx->line_start = lx->base + i + 1;
+        }
+    }
+    if (lx->base + upto > lx->line_scan) {
+        lx->line_scan = lx->base + upto;
+    }
+}
+
+/* Makes at least need bytes available at pos; only ever true in streaming mode. */
+static int lexer_refill(Lexer *lx, size_t need) {
+    if (lx->fd < 0 || lx->at_eof) {
+        return 0;
+    }
+    if (lx->keep > 0) {
+        lexer_track_lines(lx, lx->keep);
+        memmove(lx->buf, lx->buf + lx->keep, lx->len - lx->keep);
+        lx->base += lx->keep;
+        lx->len -= lx->keep;
+        lx->pos -= lx->keep;
+        lx->keep = 0;
+    }
+    size_t want = lx->pos + need;
+    if (want + LEXER_CHUNK > lx->cap) {
+        size_t cap = want + LEXER_CHUNK;
+        char *buf = (char *)realloc(lx->buf, cap);
+        if (!buf) {
+            diag_error(lx->diag, lexer_offset(lx), "out of memory");
+            lx->at_eof = 1;
+            return 0;
+        }
+        lx->buf = buf;
+        lx->cap = cap;
+        lx->src = buf;
+    }
+    while (lx->len < want) {
+        ssize_t n = read(lx->fd, lx->buf + lx->len, lx->cap - lx->len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n < 0) {
+                diag_error(lx->diag, lexer_offset(lx), "read error");
+            }
+            lx->at_eof = 1;
+            break;
+        }
+        lx->len += (size_t)n;
+    }
+    return lx->pos + need <= lx->len;
+}
+
+static inline int lx_has(Lexer *lx, size_t n) {
+    return lx->pos + n <= lx->len || lexer_refill(lx, n);
+}
+
+/* Like lx_has, but nothing before pos is pinned, so a refill may drop it. */
+static inline int lx_has_skip(Lexer *lx, size_t n) {
+    if (lx->pos + n <= lx->len) {
+        return 1;
+    }
+    lx->keep = lx->pos;
+    return lexer_refill(lx, n);
+}
+
+static int is_space(int c) {
+    return isspace(c);
+}
+
+static int is_digit(int c) {
+    return isdigit(c);
+}
+
+static int is_not_newline(int c) {
+    return c != '\n';
+}
+
+static int is_not_star(int c) {
+    return c != '*';
+}
+
+static int is_plain_string_byte(unsigned char c) {
+    return c < 0x80 && c != '"' && c != '\\' && c != '\n';
+}
+
+#if !LEXER_SSE2
+static inline uint64_t has_byte(uint64_t w, unsigned char c) {
+    uint64_t x = w ^ (0x0101010101010101ull * c);
+    return (x - 0x0101010101010101ull) & ~x & 0x8080808080808080ull;
+}
+#endif
+
+/*
+ * Returns the first index from pos that needs a closer look inside a string
+ * literal: a quote, backslash, newline or non-ASCII byte. Whole blocks of
+ * plain ASCII are skipped without touching the UTF-8 decoder.
+ */
+static size_t scan_plain_string(const char *src, size_t pos, size_t len) {
+#if LEXER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (pos + 16 <= len) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(const void *)(src + pos));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(b, quote), _mm_cmpeq_epi8(b, backslash));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(b, newline));
+        int mask = _mm_movemask_epi8(_mm_or_si128(hit, b));
+        if (mask) {
+            return pos + (size_t)__builtin_ctz((unsigned)mask);
+        }
+        pos += 16;
+    }
+#else
+    while (pos + 8 <= len) {
+        uint64_t w;
+        memcpy(&w, src + pos, sizeof(w));
+        if ((w & 0x8080808080808080ull) | has_byte(w, '"') | has_byte(w, '\\') | has_byte(w, '\n')) {
+            break;
+        }
+        pos += 8;
+    }
+#endif
+    while (pos < len && is_plain_string_byte((unsigned char)src[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+/*
+ * Advances pos while pred holds. The scan runs on locals over the current
+ * window and only goes back to the lexer state to refill, which keeps the
+ * in-memory case as tight as a plain loop over src.
+ */
+static inline void lx_skip_while(Lexer *lx, int (*pred)(int), int pinned) {
     for (;;) {
-        while (lx->pos < lx->len && isspace((unsigned char)lx->src[lx->pos])) {
-            lx->pos++;
+        const char *src = lx->src;
+        size_t len = lx->len;
+        size_t pos = lx->pos;
+        while (pos < len && pred((unsigned char)src[pos])) {
+            pos++;
+        }
+        lx->pos = pos;
+        if (pos < len) {
+            return;
+        }
+        if (!pinned) {
+            lx->keep = pos;
+        }
+        if (!lexer_refill(lx, 1)) {
+            return;
+        }
+    }
+}
+
+/* Length of the UTF-8 sequence at pos, or 0 if it is malformed. */
+static size_t lx_utf8(Lexer *lx, uint32_t *cp) {
+    lx_has(lx, 4);
+    return utf8_decode((const unsigned char *)lx->src + lx->pos, lx->len - lx->pos, cp);
+}
+
+/* Length of the \\uXXXX escape at pos, or 0 if there isn't one. */
+static size_t lx_unicode_escape(Lexer *lx, uint32_t *cp) {
+    size_t n = 1;
+    while (lx_has(lx, n + 1) && lx->src[lx->pos + n] == 'u') {
+        n++;
+    }
+    lx_has(lx, n + 4);
+    return unicode_escape_at(lx->src + lx->pos, lx->len - lx->pos, cp);
+}
+
+/* Length of the string escape at pos, or 0 if it is invalid. */
+static size_t lx_string_escape(Lexer *lx) {
+    if (!lx_has(lx, 2)) return 0;
+    char e = lx->src[lx->pos + 1];
+    if (e == 'u') {
+        uint32_t cp;
+        return lx_unicode_escape(lx, &cp);
+    }
+    if (is_octal((unsigned char)e)) {
+        size_t max = e <= '3' ? 4 : 3;
+        size_t n = 2;
+        while (n < max && lx_has(lx, n + 1) && is_octal((unsigned char)lx->src[lx->pos + n])) {
+            n++;
         }
-        if (lx->pos + 1 < lx->len && lx->src[lx->pos] == '/' && lx->src[lx->pos + 1] == '/') {
+        return n;
+    }
+    switch (e) {
+        case 'b': case 't': case 'n': case 'f': case 'r': case 's':
+        case '"': case '\'': case '\\':
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Replaces the spelling of a token that contains escapes with its decoded
+ * text in the arena, quotes kept for strings. Without an arena (token-only
+ * scans) the token keeps its source spelling.
+ */
+static void lexer_decode(Lexer *lx, Token *t, int quoted) {
+    if (!lx->arena) return;
+    char *buf = (char *)arena_alloc(lx->arena, t->len + 1);
+    if (!buf) {
+        diag_error(lx->diag, t->pos, "out of memory");
+        return;
+    }
+    size_t n;
+    if (quoted) {
+        buf[0] = '"';
+        n = 1 + decode_escapes(t->start + 1, t->len - 2, buf + 1);
+        buf[n++] = '"';
+    } else {
+        n = decode_escapes(t->start, t->len, buf);
+    }
+    t->start = buf;
+    t->len = n;
+    lx->decoded = 1;
+}
+
+static void skip_ws_and_comments(Lexer *lx) {
+    for (;;) {
+        lx_skip_while(lx, is_space, 0);
+        if (lx_has_skip(lx, 2) && lx->src[lx->pos] == '/' && lx->src[lx->pos + 1] == '/') {
             lx->pos += 2;
-            while (lx->pos < lx->len && lx->src[lx->pos] != '\n') {
-                lx->pos++;
-            }
+            lx_skip_while(lx, is_not_newline, 0);
             continue;
         }
-        if (lx->pos + 1 < lx->len && lx->src[lx->pos] == '/' && lx->src[lx->pos + 1] == '*') {
+        if (lx_has_skip(lx, 2) && lx->src[lx->pos] == '/' && lx->src[lx->pos + 1] == '*') {
             lx->pos += 2;
-            while (lx->pos + 1 < lx->len) {
-                if (lx->src[lx->pos] == '*' && lx->src[lx->pos + 1] == '/') {
+            for (;;) {
+                lx_skip_while(lx, is_not_star, 0);
+                if (!lx_has_skip(lx, 2)) {
+                    break;
+                }
+                if (lx->src[lx->pos + 1] == '/') {
                     lx->pos += 2;
                     break;
                 }
@@ -74,45 +605,122 @@ static void skip_ws_and_comments(Lexer *lx) {
     }
 }
 
-Token lexer_next(Lexer *lx) {
-    skip_ws_and_comments(lx);
+static void stream_record_line(Lexer *lx) {
+    lexer_track_lines(lx, lx->pos);
+    if (lx->line_start != lx->line_recorded) {
+        diag_add_line(lx->diag, lx->line_start, lx->line);
+        lx->line_recorded = lx->line_start;
+    }
+}
+
+/* For operators that may be followed by `second`, e.g. '<' and "<=". */
+static Token lx_one_or_two(Lexer *lx, char second, TokenType one, TokenType two) {
+    if (lx_has(lx, 1) && lx->src[lx->pos] == second) {
+        lx->pos++;
+        return make_token(lx, two, lx->keep, lx->pos);
+    }
+    return make_token(lx, one, lx->keep, lx->pos);
+}
 
-    if (lx->pos >= lx->len) {
+/* Continues an identifier from pos; ASCII runs take the plain loop. */
+static Token scan_ident(Lexer *lx, int escaped) {
+    for (;;) {
+        lx_skip_while(lx, is_ident_part, 1);
+        if (!lx_has(lx, 1)) break;
+        unsigned char b = (unsigned char)lx->src[lx->pos];
+        uint32_t cp = 0;
+        size_t n;
+        if (b >= 0x80) {
+            n = lx_utf8(lx, &cp);
+        } else if (b == '\\') {
+            n = lx_unicode_escape(lx, &cp);
+        } else {
+            break;
+        }
+        if (!n || !is_ident_code_point(cp, 0)) break;
+        escaped |= b == '\\';
+        lx->pos += n;
+    }
+    Token t = make_token(lx, TOK_IDENT, lx->keep, lx->pos);
+    if (escaped) {
+        lexer_decode(lx, &t, 0);
+    }
+    t.type = keyword_type(t.start, t.len);
+    return t;
+}
+
+static Token scan_string(Lexer *lx) {
+    int escaped = 0;
+    for (;;) {
+        lx->pos = scan_plain_string(lx->src, lx->pos, lx->len);
+        if (!lx_has(lx, 1) || lx->src[lx->pos] == '\n') {
+            diag_error(lx->diag, lx->base + lx->keep, "unterminated string literal");
+            return make_token(lx, TOK_EOF, lx->pos, lx->pos);
+        }
+        unsigned char c = (unsigned char)lx->src[lx->pos];
+        if (c == '"') {
+            lx->pos++;
+            break;
+        }
+        uint32_t cp;
+        size_t n = c == '\\' ? lx_string_escape(lx) : lx_utf8(lx, &cp);
+        if (!n) {
+            diag_error(lx->diag, lexer_offset(lx), c == '\\' ? "invalid escape sequence" : "invalid UTF-8 sequence");
+            return make_token(lx, TOK_EOF, lx->pos, lx->pos);
+        }
+        escaped |= c == '\\';
+        lx->pos += n;
+    }
+    Token t = make_token(lx, TOK_STRING_LIT, lx->keep, lx->pos);
+    if (escaped) {
+        lexer_decode(lx, &t, 1);
+    }
+    return t;
+}
+
+/* A non-ASCII byte or a backslash outside a string can only start an identifier. */
+static Token scan_ident_start(Lexer *lx, unsigned char c) {
+    uint32_t cp = 0;
+    size_t n = c == '\\' ? lx_unicode_escape(lx, &cp) : lx_utf8(lx, &cp);
+    if (n && is_ident_code_point(cp, 1)) {
+        lx->pos += n;
+        return scan_ident(lx, c == '\\');
+    }
+    if (c != '\\' && !n) {
+        diag_error(lx->diag, lexer_offset(lx), "invalid UTF-8 sequence");
+    } else if (c != '\\' || n) {
+        diag_error(lx->diag, lexer_offset(lx), "unexpected character U+%04X", (unsigned)cp);
+    } else {
+        diag_error(lx->diag, lexer_offset(lx), "unexpected character '\\'");
+    }
+    return make_token(lx, TOK_EOF, lx->pos, lx->pos);
+}
+
+static Token lexer_scan(Lexer *lx) {
+    if (!lx_has(lx, 1)) {
         return make_token(lx, TOK_EOF, lx->pos, lx->pos);
     }
 
     size_t start = lx->pos;
+    lx->keep = start;
     char c = lx->src[lx->pos++];
 
     if (is_ident_start((unsigned char)c)) {
-        while (lx->pos < lx->len && is_ident_part((unsigned char)lx->src[lx->pos])) {
-            lx->pos++;
-        }
-        TokenType type = keyword_type(lx->src + start, lx->pos - start);
-        return make_token(lx, type, start, lx->pos);
+        return scan_ident(lx, 0);
+    }
+
+    if ((unsigned char)c >= 0x80 || c == '\\') {
+        lx->pos--;
+        return scan_ident_start(lx, (unsigned char)c);
     }
 
     if (isdigit((unsigned char)c)) {
-        while (lx->pos < lx->len && isdigit((unsigned char)lx->src[lx->pos])) {
-            lx->pos++;
-        }
-        return make_token(lx, TOK_INT_LIT, start, lx->pos);
+        lx_skip_while(lx, is_digit, 1);
+        return make_token(lx, TOK_INT_LIT, lx->keep, lx->pos);
     }
 
     if (c == '"') {
-        while (lx->pos < lx->len && lx->src[lx->pos] != '"') {
-            if (lx->src[lx->pos] == '\n') {
-                diag_error(lx->diag, start, "unterminated string literal");
-                return make_token(lx, TOK_EOF, lx->pos, lx->pos);
-            }
-            lx->pos++;
-        }
-        if (lx->pos >= lx->len) {
-            diag_error(lx->diag, start, "unterminated string literal");
-            return make_token(lx, TOK_EOF, lx->pos, lx->pos);
-        }
-        lx->pos++; /* closing quote */
-        return make_token(lx, TOK_STRING_LIT, start, lx->pos);
+        return scan_string(lx);
     }
 
     switch (c) {
@@ -125,19 +733,39 @@ Token lexer_next(Lexer *lx) {
         case ';': return make_token(lx, TOK_SEMI, start, lx->pos);
         case ',': return make_token(lx, TOK_COMMA, start, lx->pos);
         case '.': return make_token(lx, TOK_DOT, start, lx->pos);
-        case '=': return make_token(lx, TOK_EQ, start, lx->pos);
-        case '+':
-            if (lx->pos < lx->len && lx->src[lx->pos] == '+') {
+        case '=': return lx_one_or_two(lx, '=', TOK_EQ, TOK_EQ_EQ);
+        case '!':
+            if (lx_has(lx, 1) && lx->src[lx->pos] == '=') {
                 lx->pos++;
-                return make_token(lx, TOK_PLUS_PLUS, start, lx->pos);
+                return make_token(lx, TOK_BANG_EQ, lx->keep, lx->pos);
             }
-            return make_token(lx, TOK_PLUS, start, lx->pos);
+            diag_error(lx->diag, lx->base + lx->keep, "unexpected character '%c'", c);
+            return make_token(lx, TOK_EOF, lx->pos, lx->pos);
+        case '<': return lx_one_or_two(lx, '=', TOK_LT, TOK_LT_EQ);
+        case '>': return lx_one_or_two(lx, '=', TOK_GT, TOK_GT_EQ);
+        case '+': return lx_one_or_two(lx, '+', TOK_PLUS, TOK_PLUS_PLUS);
         case '-': return make_token(lx, TOK_MINUS, start, lx->pos);
         case '*': return make_token(lx, TOK_STAR, start, lx->pos);
         case '/': return make_token(lx, TOK_SLASH, start, lx->pos);
         case '%': return make_token(lx, TOK_PERCENT, start, lx->pos);
         default:
-            diag_error(lx->diag, start, "unexpected character '%c'", c);
+            diag_error(lx->diag, lx->base + start, "unexpected character '%c'", c);
             return make_token(lx, TOK_EOF, lx->pos, lx->pos);
     }
 }
+
+Token lexer_next(Lexer *lx) {
+    lx->decoded = 0;
+    skip_ws_and_comments(lx);
+    if (lx->fd >= 0) {
+        stream_record_line(lx);
+    }
+    Token t = lexer_scan(lx);
+    if (lx->fd >= 0) {
+        stream_token_text(lx, &t);
+    }
+    if (t.type != TOK_EOF) {
+        lx->token_count++;
+    }
+    return t;
+}
@@ -4,15 +4,48 @@
 #include <stddef.h>
 #include "token.h"
 #include "diag.h"
+#include "arena.h"
 
+/*
+ * The lexer reads from a window src[0..len) that starts at absolute input
+ * offset base. For an in-memory source the window is the whole input and
+ * base stays 0. In streaming mode (lexer_init_fd) the window is refilled from
+ * fd in LEXER_CHUNK steps; consumed bytes are dropped, so token text that
+ * must outlive the window is copied into the arena.
+ *
+ * Identifiers may use UTF-8 and \uXXXX escapes, and string literals may
+ * use Java's escapes. Tokens that contain escapes are decoded into the
+ * arena when there is one (the parser always sets it); their text then
+ * points there instead of into the source, with quotes kept for strings.
+ */
 typedef struct {
     const char *src;
     size_t len;
     size_t pos;
     Diag *diag;
+    size_t token_count;
+
+    size_t base;
+    int fd;
+    int at_eof;
+    char *buf;
+    size_t cap;
+    size_t keep;
+    Arena *arena;
+    size_t line;
+    size_t line_start;
+    size_t line_scan;
+    size_t line_recorded;
+    int decoded;
 } Lexer;
 
 void lexer_init(Lexer *lx, const char *src, size_t len, Diag *diag);
+void lexer_init_fd(Lexer *lx, int fd, Diag *diag, Arena *arena);
+void lexer_free(Lexer *lx);
 Token lexer_next(Lexer *lx);
 
+static inline size_t lexer_offset(const Lexer *lx) {
+    return lx->base + lx->pos;
+}
+
 #endif
@@ -12,10 +12,17 @@ static Ast *ast_new(Parser *ps, AstKind kind, Token tok) {
     node->kind = kind;
     node->tok = tok;
     node->next = NULL;
+    ps->node_counts[kind]++;
     return node;
 }
 
 static void ps_advance(Parser *ps) {
+    ps->last_end = ps->current.pos + ps->current.len;
+    if (ps->has_peeked) {
+        ps->current = ps->peeked;
+        ps->has_peeked = 0;
+        return;
+    }
     ps->current = lexer_next(&ps->lx);
 }
 
@@ -37,19 +44,75 @@ static Token ps_expect(Parser *ps, TokenType type, const char *msg) {
     return t;
 }
 
-void parser_init(Parser *ps, const char *src, size_t len, Diag *diag, Arena *arena) {
-    lexer_init(&ps->lx, src, len, diag);
+static void parser_start(Parser *ps, Diag *diag, Arena *arena) {
     ps->diag = diag;
     ps->arena = arena;
+    ps->has_peeked = 0;
+    ps->skip_bodies = 0;
+    ps->last_end = lexer_offset(&ps->lx);
+    memset(ps->node_counts, 0, sizeof(ps->node_counts));
+    memset(&ps->expr, 0, sizeof(ps->expr));
     ps->current = lexer_next(&ps->lx);
 }
 
+void parser_init(Parser *ps, const char *src, size_t len, Diag *diag, Arena *arena) {
+    lexer_init(&ps->lx, src, len, diag);
+    ps->lx.arena = arena;
+    parser_start(ps, diag, arena);
+}
+
+void parser_init_span(Parser *ps, const char *src, size_t len, size_t base, Diag *diag, Arena *arena) {
+    lexer_init(&ps->lx, src, len, diag);
+    ps->lx.arena = arena;
+    ps->lx.base = base;
+    parser_start(ps, diag, arena);
+}
+
+void parser_init_fd(Parser *ps, int fd, Diag *diag, Arena *arena) {
+    lexer_init_fd(&ps->lx, fd, diag, arena);
+    parser_start(ps, diag, arena);
+}
+
+void parser_free(Parser *ps) {
+    lexer_free(&ps->lx);
+}
+
 static Token ps_peek(Parser *ps) {
-    Lexer saved = ps->lx;
-    Token cur = ps->current;
-    Token next = lexer_next(&saved);
-    (void)cur;
-    return next;
+    if (!ps->has_peeked) {
+        ps->peeked = lexer_next(&ps->lx);
+        ps->has_peeked = 1;
+    }
+    return ps->peeked;
+}
+
+/*
+ * Returns a + mid + b. Names written without spaces in an in-memory source
+ * are already contiguous there and are returned in place; anything else
+ * (streamed input, spaced-out names) is copied into the arena.
+ */
+static Str ps_join(Parser *ps, Str a, const char *mid, Str b) {
+    size_t mid_len = strlen(mid);
+    const char *src = ps->lx.src;
+    if (ps->lx.fd < 0 && a.data >= src && a.data + a.len + mid_len + b.len <= src + ps->lx.len &&
+        (b.len == 0 || b.data == a.data + a.len + mid_len) && memcmp(a.data + a.len, mid, mid_len) == 0) {
+        Str s;
+        s.data = a.data;
+        s.len = a.len + mid_len + b.len;
+        return s;
+    }
+    char *buf = (char *)arena_alloc(ps->arena, a.len + mid_len + b.len + 1);
+    if (!buf) {
+        return a;
+    }
+    memcpy(buf, a.data, a.len);
+    memcpy(buf + a.len, mid, mid_len);
+    if (b.len) {
+        memcpy(buf + a.len + mid_len, b.data, b.len);
+    }
+    Str s;
+    s.data = buf;
+    s.len = a.len + mid_len + b.len;
+    return s;
 }
 
 static Ast *parse_expr(Parser *ps);
@@ -77,17 +140,13 @@ static Ast *parse_primary(Parser *ps) {
         return node;
     }
     if (ps_match(ps, TOK_IDENT)) {
-        size_t start = t.pos;
-        size_t end = t.pos + t.len;
+        Str name = token_text(t);
         int dotted = 0;
         while (ps_match(ps, TOK_DOT)) {
             Token part = ps_expect(ps, TOK_IDENT, "expected identifier after '.'");
             dotted = 1;
-            end = part.pos + part.len;
+            name = ps_join(ps, name, ".", token_text(part));
         }
-        Str name;
-        name.data = ps->lx.src + start;
-        name.len = end - start;
         if (ps_match(ps, TOK_LPAREN)) {
             Ast *call = ast_new(ps, AST_CALL, t);
             if (!call) return NULL;
@@ -114,11 +173,6 @@ static Ast *parse_primary(Parser *ps) {
         node->as.new_expr.class_name = token_text(name);
         return node;
     }
-    if (ps_match(ps, TOK_LPAREN)) {
-        Ast *expr = parse_expr(ps);
-        ps_expect(ps, TOK_RPAREN, "expected ')' after expression");
-        return expr;
-    }
     diag_error(ps->diag, t.pos, "expected expression");
     return NULL;
 }
@@ -144,49 +198,173 @@ static Ast *parse_call_args(Parser *ps) {
     return head;
 }
 
+static const int bin_prec_table[TOK_COUNT] = {
+    [TOK_PLUS] = 10,
+    [TOK_MINUS] = 10,
+    [TOK_STAR] = 20,
+    [TOK_SLASH] = 20,
+    [TOK_PERCENT] = 20,
+    [TOK_LT] = 6,
+    [TOK_LT_EQ] = 6,
+    [TOK_GT] = 6,
+    [TOK_GT_EQ] = 6,
+    [TOK_EQ_EQ] = 4,
+    [TOK_BANG_EQ] = 4,
+};
+
 static int bin_prec(TokenType type) {
-    switch (type) {
-        case TOK_PLUS:
-        case TOK_MINUS:
-            return 10;
-        case TOK_STAR:
-        case TOK_SLASH:
-        case TOK_PERCENT:
-            return 20;
-        default:
-            return 0;
+    return bin_prec_table[type];
+}
+
+/* Doubles an arena-backed stack; the old block is left to the arena. */
+static void *expr_grow(Parser *ps, void *old, size_t len, size_t *cap, size_t elem) {
+    size_t new_cap = *cap ? *cap * 2 : 64;
+    void *buf = arena_alloc(ps->arena, new_cap * elem);
+    if (!buf) {
+        diag_error(ps->diag, ps->current.pos, "out of memory");
+        return NULL;
+    }
+    if (len) {
+        memcpy(buf, old, len * elem);
+    }
+    *cap = new_cap;
+    return buf;
+}
+
+static int expr_push_operand(Parser *ps, Ast *node, size_t post_start) {
+    ExprStacks *st = &ps->expr;
+    if (st->operand_len == st->operand_cap) {
+        ExprOperand *grown = (ExprOperand *)expr_grow(ps, st->operands, st->operand_len, &st->operand_cap, sizeof(ExprOperand));
+        if (!grown) return 0;
+        st->operands = grown;
+    }
+    st->operands[st->operand_len].node = node;
+    st->operands[st->operand_len].post_start = post_start;
+    st->operand_len++;
+    return 1;
+}
+
+static int expr_push_operator(Parser *ps, Token op, int prec) {
+    ExprStacks *st = &ps->expr;
+    if (st->operator_len == st->operator_cap) {
+        ExprOperator *grown = (ExprOperator *)expr_grow(ps, st->operators, st->operator_len, &st->operator_cap, sizeof(ExprOperator));
+        if (!grown) return 0;
+        st->operators = grown;
+    }
+    st->operators[st->operator_len].op = op;
+    st->operators[st->operator_len].prec = prec;
+    st->operator_len++;
+    return 1;
+}
+
+static int expr_push_post(Parser *ps, Ast *node) {
+    ExprStacks *st = &ps->expr;
+    if (st->post_len == st->post_cap) {
+        Ast **grown = (Ast **)expr_grow(ps, st->post, st->post_len, &st->post_cap, sizeof(Ast *));
+        if (!grown) return 0;
+        st->post = grown;
+    }
+    st->post[st->post_len++] = node;
+    return 1;
+}
+
+/* Pops one operator and its two operands and pushes the AST_BIN node. */
+static int expr_reduce(Parser *ps) {
+    ExprStacks *st = &ps->expr;
+    ExprOperator op = st->operators[--st->operator_len];
+    ExprOperand rhs = st->operands[--st->operand_len];
+    ExprOperand lhs = st->operands[--st->operand_len];
+    Ast *node = ast_new(ps, AST_BIN, op.op);
+    if (!node) return 0;
+    node->as.bin.op = op.op.type;
+    node->as.bin.lhs = lhs.node;
+    node->as.bin.rhs = rhs.node;
+    if (!expr_push_post(ps, node)) return 0;
+    node->as.bin.post_len = st->post_len - lhs.post_start;
+    return expr_push_operand(ps, node, lhs.post_start);
+}
+
+/* Copies the finished post-order out of the scratch stack and points every AST_BIN at its slice. */
+static void expr_finish_post(Parser *ps, size_t post_base) {
+    ExprStacks *st = &ps->expr;
+    size_t n = st->post_len - post_base;
+    Ast **post = (Ast **)arena_alloc(ps->arena, n * sizeof(Ast *));
+    if (!post) {
+        diag_error(ps->diag, ps->current.pos, "out of memory");
+        return;
+    }
+    memcpy(post, st->post + post_base, n * sizeof(Ast *));
+    for (size_t i = 0; i < n; i++) {
+        if (post[i]->kind == AST_BIN) {
+            post[i]->as.bin.post = post + i + 1 - post[i]->as.bin.post_len;
+        }
     }
 }
 
-static Ast *parse_bin_rhs(Parser *ps, int prec, Ast *lhs) {
+/*
+ * Precedence climbing without recursion: '(' is pushed as a prec-0 marker,
+ * each operator reduces the stack while the top binds at least as tightly
+ * (left associativity), and ')' reduces back to its marker.
+ */
+static Ast *parse_expr(Parser *ps) {
+    ExprStacks *st = &ps->expr;
+    size_t operand_base = st->operand_len;
+    size_t operator_base = st->operator_len;
+    size_t post_base = st->post_len;
+    size_t open_parens = 0;
+    Ast *result = NULL;
+
     for (;;) {
-        int tok_prec = bin_prec(ps->current.type);
-        if (tok_prec < prec) {
-            return lhs;
+        while (ps->current.type == TOK_LPAREN) {
+            if (!expr_push_operator(ps, ps->current, 0)) goto done;
+            ps_advance(ps);
+            open_parens++;
+        }
+        Ast *atom = parse_primary(ps);
+        if (!atom) goto done;
+        if (!expr_push_post(ps, atom)) goto done;
+        if (!expr_push_operand(ps, atom, st->post_len - 1)) goto done;
+
+        while (open_parens > 0 && ps->current.type == TOK_RPAREN) {
+            while (st->operators[st->operator_len - 1].prec > 0) {
+                if (!expr_reduce(ps)) goto done;
+            }
+            st->operator_len--;
+            open_parens--;
+            ps_advance(ps);
         }
-        Token op = ps->current;
-        ps_advance(ps);
-        Ast *rhs = parse_primary(ps);
-        if (!rhs) return lhs;
 
-        int next_prec = bin_prec(ps->current.type);
-        if (tok_prec < next_prec) {
-            rhs = parse_bin_rhs(ps, tok_prec + 1, rhs);
+        int prec = bin_prec(ps->current.type);
+        if (prec == 0) {
+            break;
+        }
+        while (st->operator_len > operator_base && st->operators[st->operator_len - 1].prec >= prec) {
+            if (!expr_reduce(ps)) goto done;
         }
+        if (!expr_push_operator(ps, ps->current, prec)) goto done;
+        ps_advance(ps);
+    }
 
-        Ast *node = ast_new(ps, AST_BIN, op);
-        if (!node) return lhs;
-        node->as.bin.op = op.type;
-        node->as.bin.lhs = lhs;
-        node->as.bin.rhs = rhs;
-        lhs = node;
+    if (open_parens > 0) {
+        diag_error(ps->diag, ps->current.pos, "expected ')' after expression");
+    }
+    while (st->operator_len > operator_base) {
+        if (st->operators[st->operator_len - 1].prec == 0) {
+            st->operator_len--;
+            continue;
+        }
+        if (!expr_reduce(ps)) goto done;
+    }
+    result = st->operands[operand_base].node;
+    if (result->kind == AST_BIN) {
+        expr_finish_post(ps, post_base);
     }
-}
 
-static Ast *parse_expr(Parser *ps) {
-    Ast *lhs = parse_primary(ps);
-    if (!lhs) return NULL;
-    return parse_bin_rhs(ps, 1, lhs);
+done:
+    st->operand_len = operand_base;
+    st->operator_len = operator_base;
+    st->post_len = post_base;
+    return result;
 }
 
 static Str parse_type(Parser *ps) {
@@ -196,21 +374,19 @@ static Str parse_type(Parser *ps) {
         Str s = {0};
         return s;
     }
-    size_t start = t.pos;
-    size_t end = t.pos + t.len;
+    Str s = token_text(t);
     while (ps_match(ps, TOK_LBRACKET)) {
-        Token right = ps_expect(ps, TOK_RBRACKET, "expected ']' after '[' in type");
-        end = right.pos + right.len;
+        ps_expect(ps, TOK_RBRACKET, "expected ']' after '[' in type");
+        Str none = {0};
+        s = ps_join(ps, s, "[]", none);
     }
-    Str s;
-    s.data = ps->lx.src + start;
-    s.len = end - start;
     return s;
 }
 
 static Ast *parse_block(Parser *ps);
 
-static Ast *parse_statement(Parser *ps) {
+/* Assignment, increment, local declaration or expression, without the ';'. */
+static Ast *parse_simple_stmt(Parser *ps) {
     if (ps->current.type == TOK_IDENT) {
         Token ident = ps->current;
         Token next = ps_peek(ps);
@@ -218,7 +394,6 @@ static Ast *parse_statement(Parser *ps) {
             ps_advance(ps);
             ps_expect(ps, TOK_EQ, "expected '=' in assignment");
             Ast *value = parse_expr(ps);
-            ps_expect(ps, TOK_SEMI, "expected ';' after assignment");
             Ast *node = ast_new(ps, AST_ASSIGN, ident);
             if (!node) return NULL;
             node->as.assign.name = token_text(ident);
@@ -228,13 +403,54 @@ static Ast *parse_statement(Parser *ps) {
         if (next.type == TOK_PLUS_PLUS) {
             ps_advance(ps);
             ps_expect(ps, TOK_PLUS_PLUS, "expected '++'");
-            ps_expect(ps, TOK_SEMI, "expected ';' after increment");
             Ast *node = ast_new(ps, AST_INC, ident);
             if (!node) return NULL;
             node->as.inc.name = token_text(ident);
             return node;
         }
     }
+
+    if (ps->current.type == TOK_KW_INT || (ps->current.type == TOK_IDENT && ps_peek(ps).type == TOK_IDENT)) {
+        Str type = parse_type(ps);
+        Token name = ps_expect(ps, TOK_IDENT, "expected identifier in variable declaration");
+        Ast *node = ast_new(ps, AST_VAR_DECL, name);
+        if (!node) return NULL;
+        node->as.var_decl.type = type;
+        node->as.var_decl.name = token_text(name);
+        node->as.var_decl.init = NULL;
+        if (ps_match(ps, TOK_EQ)) {
+            node->as.var_decl.init = parse_expr(ps);
+        }
+        return node;
+    }
+
+    Ast *expr = parse_expr(ps);
+    Ast *stmt = ast_new(ps, AST_EXPR_STMT, expr ? expr->tok : ps->current);
+    if (!stmt) return NULL;
+    stmt->as.expr_stmt.expr = expr;
+    return stmt;
+}
+
+static const char *simple_stmt_end_msg(Ast *stmt) {
+    switch (stmt ? stmt->kind : AST_EXPR_STMT) {
+        case AST_ASSIGN: return "expected ';' after assignment";
+        case AST_INC: return "expected ';' after increment";
+        case AST_VAR_DECL: return "expected ';' after variable declaration";
+        default: return "expected ';' after expression";
+    }
+}
+
+static Ast *parse_condition(Parser *ps, const char *keyword) {
+    if (!ps_match(ps, TOK_LPAREN)) {
+        diag_error(ps->diag, ps->current.pos, "expected '(' after '%s'", keyword);
+    }
+    Ast *cond = parse_expr(ps);
+    ps_expect(ps, TOK_RPAREN, "expected ')' after condition");
+    return cond;
+}
+
+static Ast *parse_statement(Parser *ps) {
+    Token start = ps->current;
     if (ps_match(ps, TOK_KW_RETURN)) {
         Token t = ps->current;
         Ast *expr = NULL;
@@ -252,26 +468,51 @@ static Ast *parse_statement(Parser *ps) {
         return parse_block(ps);
     }
 
-    if (ps->current.type == TOK_KW_INT || (ps->current.type == TOK_IDENT && ps_peek(ps).type == TOK_IDENT)) {
-        Str type = parse_type(ps);
-        Token name = ps_expect(ps, TOK_IDENT, "expected identifier in variable declaration");
-        Ast *node = ast_new(ps, AST_VAR_DECL, name);
+    if (ps_match(ps, TOK_KW_IF)) {
+        Ast *node = ast_new(ps, AST_IF, start);
         if (!node) return NULL;
-        node->as.var_decl.type = type;
-        node->as.var_decl.name = token_text(name);
-        node->as.var_decl.init = NULL;
-        if (ps_match(ps, TOK_EQ)) {
-            node->as.var_decl.init = parse_expr(ps);
+        node->as.if_stmt.cond = parse_condition(ps, "if");
+        node->as.if_stmt.then_branch = parse_statement(ps);
+        node->as.if_stmt.else_branch = NULL;
+        if (ps_match(ps, TOK_KW_ELSE)) {
+            node->as.if_stmt.else_branch = parse_statement(ps);
         }
-        ps_expect(ps, TOK_SEMI, "expected ';' after variable declaration");
         return node;
     }
 
-    Ast *expr = parse_expr(ps);
-    ps_expect(ps, TOK_SEMI, "expected ';' after expression");
-    Ast *stmt = ast_new(ps, AST_EXPR_STMT, expr ? expr->tok : ps->current);
-    if (!stmt) return NULL;
-    stmt->as.expr_stmt.expr = expr;
+    if (ps_match(ps, TOK_KW_WHILE)) {
+        Ast *node = ast_new(ps, AST_WHILE, start);
+        if (!node) return NULL;
+        node->as.while_stmt.cond = parse_condition(ps, "while");
+        node->as.while_stmt.body = parse_statement(ps);
+        return node;
+    }
+
+    if (ps_match(ps, TOK_KW_FOR)) {
+        Ast *node = ast_new(ps, AST_FOR, start);
+        if (!node) return NULL;
+        ps_expect(ps, TOK_LPAREN, "expected '(' after 'for'");
+        node->as.for_stmt.init = NULL;
+        node->as.for_stmt.cond = NULL;
+        node->as.for_stmt.update = NULL;
+        if (ps->current.type != TOK_SEMI) {
+            node->as.for_stmt.init = parse_simple_stmt(ps);
+        }
+        ps_expect(ps, TOK_SEMI, "expected ';' after for initializer");
+        if (ps->current.type != TOK_SEMI) {
+            node->as.for_stmt.cond = parse_expr(ps);
+        }
+        ps_expect(ps, TOK_SEMI, "expected ';' after for condition");
+        if (ps->current.type != TOK_RPAREN) {
+            node->as.for_stmt.update = parse_simple_stmt(ps);
+        }
+        ps_expect(ps, TOK_RPAREN, "expected ')' after for clauses");
+        node->as.for_stmt.body = parse_statement(ps);
+        return node;
+    }
+
+    Ast *stmt = parse_simple_stmt(ps);
+    ps_expect(ps, TOK_SEMI, simple_stmt_end_msg(stmt));
     return stmt;
 }
 
@@ -295,6 +536,27 @@ static Ast *parse_block(Parser *ps) {
     return node;
 }
 
+/* Matches braces over the body's tokens without building it. */
+static Ast *skip_block(Parser *ps) {
+    ArenaMark mark = arena_mark(ps->arena);
+    ps_expect(ps, TOK_LBRACE, "expected '{' to start block");
+    size_t depth = 1;
+    while (ps->current.type != TOK_EOF) {
+        if (ps->current.type == TOK_LBRACE) {
+            depth++;
+        } else if (ps->current.type == TOK_RBRACE && --depth == 0) {
+            break;
+        }
+        ps_advance(ps);
+    }
+    ps_expect(ps, TOK_RBRACE, "expected '}' to close block");
+    /* Streamed token text is copied into the arena; a skipped body keeps none of it. */
+    if (ps->lx.fd >= 0) {
+        parser_release(ps, mark);
+    }
+    return NULL;
+}
+
 static Ast *parse_params(Parser *ps) {
     Ast *head = NULL;
     Ast *tail = NULL;
@@ -342,7 +604,7 @@ static Ast *parse_member(Parser *ps) {
         method->as.method_decl.name = token_text(name);
         method->as.method_decl.params = parse_params(ps);
         ps_expect(ps, TOK_RPAREN, "expected ')' after parameters");
-        method->as.method_decl.body = parse_block(ps);
+        method->as.method_decl.body = ps->skip_bodies ? skip_block(ps) : parse_block(ps);
         return method;
     }
     Ast *field = ast_new(ps, AST_FIELD, name);
@@ -353,7 +615,7 @@ static Ast *parse_member(Parser *ps) {
     return field;
 }
 
-static Ast *parse_class(Parser *ps) {
+static Ast *parse_class_header(Parser *ps) {
     ps_match(ps, TOK_KW_PUBLIC);
     Token t = ps_expect(ps, TOK_KW_CLASS, "expected 'class'");
     Token name = ps_expect(ps, TOK_IDENT, "expected class name");
@@ -362,6 +624,30 @@ static Ast *parse_class(Parser *ps) {
     node->as.class_decl.name = token_text(name);
 
     ps_expect(ps, TOK_LBRACE, "expected '{' after class name");
+    return node;
+}
+
+Ast *parse_next_member(Parser *ps) {
+    if (ps->current.type == TOK_RBRACE || ps->current.type == TOK_EOF) {
+        return NULL;
+    }
+    return parse_member(ps);
+}
+
+void parse_class_end(Parser *ps) {
+    ps_expect(ps, TOK_RBRACE, "expected '}' to close class body");
+}
+
+Ast *parse_next_class(Parser *ps) {
+    if (ps->current.type == TOK_EOF || ps->diag->had_error) {
+        return NULL;
+    }
+    return parse_class_header(ps);
+}
+
+static Ast *parse_class(Parser *ps) {
+    Ast *node = parse_class_header(ps);
+    if (!node) return NULL;
 
     Ast *head = NULL;
     Ast *tail = NULL;
@@ -375,7 +661,7 @@ static Ast *parse_class(Parser *ps) {
         }
     }
 
-    ps_expect(ps, TOK_RBRACE, "expected '}' to close class body");
+    parse_class_end(ps);
     node->as.class_decl.members = head;
     return node;
 }
@@ -383,24 +669,20 @@ static Ast *parse_class(Parser *ps) {
 static Ast *parse_import(Parser *ps) {
     Token start = ps_expect(ps, TOK_KW_IMPORT, "expected 'import'");
     Token first = ps_expect(ps, TOK_IDENT, "expected import name");
-    size_t import_start = first.pos;
-    size_t import_end = first.pos + first.len;
+    Str name = token_text(first);
     while (ps_match(ps, TOK_DOT)) {
         Token part = ps_expect(ps, TOK_IDENT, "expected identifier after '.'");
-        import_end = part.pos + part.len;
+        name = ps_join(ps, name, ".", token_text(part));
     }
     ps_expect(ps, TOK_SEMI, "expected ';' after import");
 
     Ast *node = ast_new(ps, AST_IMPORT, start);
     if (!node) return NULL;
-    Str name;
-    name.data = ps->lx.src + import_start;
-    name.len = import_end - import_start;
     node->as.import_decl.name = name;
     return node;
 }
 
-Ast *parse_compilation_unit(Parser *ps) {
+static Ast *parse_unit_imports(Parser *ps) {
     Token t = ps->current;
     Ast *node = ast_new(ps, AST_COMP_UNIT, t);
     if (!node) return NULL;
@@ -416,9 +698,80 @@ Ast *parse_compilation_unit(Parser *ps) {
             tail = imp;
         }
     }
-
-    Ast *clazz = parse_class(ps);
     node->as.comp_unit.imports = imports;
-    node->as.comp_unit.clazz = clazz;
     return node;
 }
+
+Ast *parse_unit_begin(Parser *ps) {
+    Ast *node = parse_unit_imports(ps);
+    if (!node) return NULL;
+    node->as.comp_unit.clazz = parse_class_header(ps);
+    return node;
+}
+
+/* Classes after the first are chained through next. */
+Ast *parse_compilation_unit(Parser *ps) {
+    Ast *node = parse_unit_imports(ps);
+    if (!node) return NULL;
+    node->as.comp_unit.clazz = parse_class(ps);
+    Ast *tail = node->as.comp_unit.clazz;
+    while (tail && ps->current.type != TOK_EOF && !ps->diag->had_error) {
+        tail->next = parse_class(ps);
+        tail = tail->next;
+    }
+    return node;
+}
+
+Ast *parse_declarations(Parser *ps) {
+    ps->skip_bodies = 1;
+    Ast *node = parse_compilation_unit(ps);
+    ps->skip_bodies = 0;
+    return node;
+}
+
+/* Re-homes an arena-owned streaming token whose text is about to be released. */
+static int ps_save_token(Parser *ps, Token *t, char **saved) {
+    *saved = NULL;
+    if (ps->lx.fd < 0 || !(t->type == TOK_IDENT || t->type == TOK_INT_LIT || t->type == TOK_STRING_LIT)) {
+        return 1;
+    }
+    *saved = (char *)malloc(t->len + 1);
+    if (!*saved) {
+        return 0;
+    }
+    memcpy(*saved, t->start, t->len);
+    t->start = *saved;
+    return 1;
+}
+
+static void ps_restore_token(Parser *ps, Token *t, char *saved) {
+    if (!saved) {
+        return;
+    }
+    char *copy = (char *)arena_alloc(ps->arena, t->len + 1);
+    if (copy) {
+        memcpy(copy, saved, t->len);
+        t->start = copy;
+    } else {
+        t->start = "";
+        t->len = 0;
+    }
+    free(saved);
+}
+
+void parser_release(Parser *ps, ArenaMark mark) {
+    char *saved_current = NULL;
+    char *saved_peeked = NULL;
+    if (!ps_save_token(ps, &ps->current, &saved_current) ||
+        (ps->has_peeked && !ps_save_token(ps, &ps->peeked, &saved_peeked))) {
+        free(saved_current);
+        return;
+    }
+    arena_reset(ps->arena, mark);
+    /* The expression stacks may have been grown past the mark. */
+    memset(&ps->expr, 0, sizeof(ps->expr));
+    ps_restore_token(ps, &ps->current, saved_current);
+    if (ps->has_peeked) {
+        ps_restore_token(ps, &ps->peeked, saved_peeked);
+    }
+}
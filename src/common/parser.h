@@ -7,14 +7,71 @@
 #include "lexer.h"
 #include "diag.h"
 
+typedef struct {
+    Ast *node;
+    size_t post_start;
+} ExprOperand;
+
+typedef struct {
+    Token op;
+    int prec;
+} ExprOperator;
+
+/*
+ * Expressions are parsed with explicit operand/operator stacks. The stacks
+ * live in the arena and are shared by nested expressions (call arguments),
+ * each of which only uses the part above the depth it started at.
+ */
+typedef struct {
+    ExprOperand *operands;
+    size_t operand_len;
+    size_t operand_cap;
+    ExprOperator *operators;
+    size_t operator_len;
+    size_t operator_cap;
+    Ast **post;
+    size_t post_len;
+    size_t post_cap;
+} ExprStacks;
+
 typedef struct {
     Lexer lx;
     Token current;
+    Token peeked;
+    int has_peeked;
     Diag *diag;
     Arena *arena;
+    size_t node_counts[AST_KIND_COUNT];
+    ExprStacks expr;
+    int skip_bodies;
+    size_t last_end; /* input offset just past the last consumed token */
 } Parser;
 
 void parser_init(Parser *ps, const char *src, size_t len, Diag *diag, Arena *arena);
+/* Parses src as the slice of a larger input that starts at offset base. */
+void parser_init_span(Parser *ps, const char *src, size_t len, size_t base, Diag *diag, Arena *arena);
+void parser_init_fd(Parser *ps, int fd, Diag *diag, Arena *arena);
+void parser_free(Parser *ps);
 Ast *parse_compilation_unit(Parser *ps);
 
+/*
+ * Declarations-only parse for building a symbol index: method bodies are
+ * skipped by brace matching over their tokens and left NULL. When
+ * streaming, a skipped body's token text is released from the arena.
+ */
+Ast *parse_declarations(Parser *ps);
+
+/*
+ * Member-at-a-time parsing: parse_unit_begin parses the imports and the
+ * class header, parse_next_member returns members until the closing brace
+ * (NULL then), and parse_class_end consumes it. parse_next_class returns
+ * the header of the file's next class, or NULL. parser_release rewinds the
+ * arena to a mark taken before a member, keeping the lookahead token valid.
+ */
+Ast *parse_unit_begin(Parser *ps);
+Ast *parse_next_member(Parser *ps);
+void parse_class_end(Parser *ps);
+Ast *parse_next_class(Parser *ps);
+void parser_release(Parser *ps, ArenaMark mark);
+
 #endif
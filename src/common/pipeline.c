@@ -0,0 +1,60 @@
+#include "pipeline.h"
+
+#include "type_check.h"
+
+/* Checks and emits clazz's members up to its closing brace. */
+static void compile_class(Parser *ps, Ast *clazz, Diag *diag, const PipelineHooks *hooks) {
+    Ast *fields_tail = NULL;
+    for (;;) {
+        ArenaMark mark = arena_mark(ps->arena);
+        Ast *member = parse_next_member(ps);
+        if (!member) {
+            break;
+        }
+        int ok = type_check_member(clazz, member, hooks->symbols, diag);
+        if (ok && !diag->had_error && hooks->emit_member) {
+            hooks->emit_member(clazz, member, hooks->user);
+        }
+        if (member->kind == AST_FIELD) {
+            if (fields_tail) {
+                fields_tail->next = member;
+            } else {
+                clazz->as.class_decl.members = member;
+            }
+            fields_tail = member;
+            continue;
+        }
+        parser_release(ps, mark);
+    }
+    parse_class_end(ps);
+
+    if (!diag->had_error && hooks->end_class) {
+        hooks->end_class(clazz, hooks->user);
+    }
+}
+
+int pipeline_compile(Parser *ps, Diag *diag, const PipelineHooks *hooks) {
+    if (!hooks->symbols) {
+        diag_error(diag, 0, "pipeline: a symbol index is required to resolve calls");
+        return 0;
+    }
+    Ast *unit = parse_unit_begin(ps);
+    if (!unit || !unit->as.comp_unit.clazz) {
+        return 0;
+    }
+    Ast *clazz = unit->as.comp_unit.clazz;
+    if (hooks->begin_class) {
+        hooks->begin_class(unit, hooks->user);
+    }
+
+    for (;;) {
+        compile_class(ps, clazz, diag, hooks);
+        Ast *next = parse_next_class(ps);
+        if (!next) {
+            break;
+        }
+        clazz->next = next;
+        clazz = next;
+    }
+    return !diag->had_error;
+}
@@ -0,0 +1,33 @@
+#ifndef TINYJVM_PIPELINE_H
+#define TINYJVM_PIPELINE_H
+
+#include "ast.h"
+#include "diag.h"
+#include "parser.h"
+#include "symbols.h"
+
+/*
+ * Fused front end: each member is type-checked and handed to emit_member as
+ * soon as it is parsed, then a method's AST is released back to the arena.
+ * Live AST memory is bounded by the largest method rather than the file.
+ * Fields are kept on clazz->members so end_class can still see them.
+ *
+ * begin_class runs once with the unit; a file with several classes gets
+ * emit_member and end_class calls for each. Methods are released before
+ * the calls to them are checked, so symbols must hold an index built by a
+ * declarations pre-pass; without one pipeline_compile fails at once. For
+ * streamed input that pass is symbols_scan_fd over the same file before it
+ * is rewound, so neither pass holds the whole source. main is left to the
+ * driver to check project-wide.
+ */
+typedef struct {
+    void (*begin_class)(Ast *comp_unit, void *user);
+    void (*emit_member)(Ast *clazz, Ast *member, void *user);
+    void (*end_class)(Ast *clazz, void *user);
+    void *user;
+    const SymbolIndex *symbols;
+} PipelineHooks;
+
+int pipeline_compile(Parser *ps, Diag *diag, const PipelineHooks *hooks);
+
+#endif
@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <string.h>
+#include <time.h>
+
+static double clock_sec(clockid_t id) {
+    struct timespec ts;
+    if (clock_gettime(id, &ts) != 0) {
+        return 0.0;
+    }
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void stats_init(CompileStats *st) {
+    memset(st, 0, sizeof(*st));
+    st->mode = STATS_OFF;
+}
+
+int stats_parse_flag(CompileStats *st, const char *arg) {
+    if (strcmp(arg, "-Xtime") == 0) {
+        st->mode = STATS_TEXT;
+        return 1;
+    }
+    if (strcmp(arg, "-Xstats=json") == 0) {
+        st->mode = STATS_JSON;
+        return 1;
+    }
+    return 0;
+}
+
+void stats_begin(CompileStats *st, Phase phase) {
+    if (st->mode == STATS_OFF) {
+        return;
+    }
+    st->phases[phase].wall_start = clock_sec(CLOCK_MONOTONIC);
+    st->phases[phase].cpu_start = clock_sec(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void stats_end(CompileStats *st, Phase phase) {
+    if (st->mode == STATS_OFF) {
+        return;
+    }
+    PhaseTime *pt = &st->phases[phase];
+    pt->wall += clock_sec(CLOCK_MONOTONIC) - pt->wall_start;
+    pt->cpu += clock_sec(CLOCK_PROCESS_CPUTIME_ID) - pt->cpu_start;
+}
+
+void stats_collect(CompileStats *st, const Parser *ps, const Diag *diag) {
+    st->input_bytes = ps->lx.base + ps->lx.len;
+    st->tokens = ps->lx.token_count;
+    memcpy(st->nodes, ps->node_counts, sizeof(st->nodes));
+    arena_stats(ps->arena, &st->arena);
+    st->diagnostics = diag->error_count;
+}
+
+const char *stats_phase_name(Phase phase) {
+    switch (phase) {
+        case PHASE_READ: return "read";
+        case PHASE_LEX: return "lex";
+        case PHASE_PARSE: return "parse";
+        case PHASE_TYPE_CHECK: return "type_check";
+        case PHASE_FOLD: return "fold";
+        case PHASE_EMIT: return "emit";
+        case PHASE_WRITE: return "write";
+        default: return "unknown";
+    }
+}
+
+const char *stats_ast_kind_name(AstKind kind) {
+    switch (kind) {
+        case AST_COMP_UNIT: return "COMP_UNIT";
+        case AST_IMPORT: return "IMPORT";
+        case AST_CLASS: return "CLASS";
+        case AST_FIELD: return "FIELD";
+        case AST_METHOD: return "METHOD";
+        case AST_BLOCK: return "BLOCK";
+        case AST_RETURN: return "RETURN";
+        case AST_IF: return "IF";
+        case AST_WHILE: return "WHILE";
+        case AST_FOR: return "FOR";
+        case AST_VAR_DECL: return "VAR_DECL";
+        case AST_EXPR_STMT: return "EXPR_STMT";
+        case AST_ASSIGN: return "ASSIGN";
+        case AST_INC: return "INC";
+        case AST_BIN: return "BIN";
+        case AST_INT_LIT: return "INT_LIT";
+        case AST_STRING_LIT: return "STRING_LIT";
+        case AST_IDENT: return "IDENT";
+        case AST_CALL: return "CALL";
+        case AST_NEW: return "NEW";
+        default: return "UNKNOWN";
+    }
+}
+
+static void print_text(const CompileStats *st, FILE *out) {
+    double total_wall = 0.0;
+    double total_cpu = 0.0;
+    fprintf(out, "%-12s %10s %10s\n", "phase", "wall ms", "cpu ms");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseTime *pt = &st->phases[i];
+        fprintf(out, "%-12s %10.3f %10.3f\n", stats_phase_name((Phase)i), pt->wall * 1e3, pt->cpu * 1e3);
+        total_wall += pt->wall;
+        total_cpu += pt->cpu;
+    }
+    fprintf(out, "%-12s %10.3f %10.3f\n", "total", total_wall * 1e3, total_cpu * 1e3);
+    fprintf(out, "input: %zu bytes, %zu tokens\n", st->input_bytes, st->tokens);
+    fprintf(out, "ast nodes:");
+    for (int i = 0; i < AST_KIND_COUNT; i++) {
+        if (st->nodes[i]) {
+            fprintf(out, " %s=%zu", stats_ast_kind_name((AstKind)i), st->nodes[i]);
+        }
+    }
+    fprintf(out, "\n");
+    fprintf(out, "arena: %zu chunks, %zu bytes reserved, %zu bytes used\n", st->arena.chunks, st->arena.reserved,
+            st->arena.used);
+    fprintf(out, "diagnostics: %d\n", st->diagnostics);
+}
+
+static void print_json(const CompileStats *st, FILE *out) {
+    fprintf(out, "{\"phases\": {");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseTime *pt = &st->phases[i];
+        fprintf(out, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}", i ? ", " : "", stats_phase_name((Phase)i),
+                pt->wall * 1e3, pt->cpu * 1e3);
+    }
+    fprintf(out, "}, \"input_bytes\": %zu, \"tokens\": %zu, \"nodes\": {", st->input_bytes, st->tokens);
+    int first = 1;
+    for (int i = 0; i < AST_KIND_COUNT; i++) {
+        if (st->nodes[i]) {
+            fprintf(out, "%s\"%s\": %zu", first ? "" : ", ", stats_ast_kind_name((AstKind)i), st->nodes[i]);
+            first = 0;
+        }
+    }
+    fprintf(out, "}, \"arena\": {\"chunks\": %zu, \"reserved\": %zu, \"used\": %zu}, \"diagnostics\": %d}\n",
+            st->arena.chunks, st->arena.reserved, st->arena.used, st->diagnostics);
+}
+
+void stats_print(const CompileStats *st, FILE *out) {
+    switch (st->mode) {
+        case STATS_TEXT:
+            print_text(st, out);
+            break;
+        case STATS_JSON:
+            print_json(st, out);
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef TINYJVM_STATS_H
+#define TINYJVM_STATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "ast.h"
+#include "diag.h"
+#include "parser.h"
+
+typedef enum {
+    PHASE_READ,
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_TYPE_CHECK,
+    PHASE_FOLD,
+    PHASE_EMIT,
+    PHASE_WRITE,
+    PHASE_COUNT
+} Phase;
+
+typedef enum {
+    STATS_OFF,
+    STATS_TEXT,
+    STATS_JSON
+} StatsMode;
+
+typedef struct {
+    double wall;
+    double cpu;
+    double wall_start;
+    double cpu_start;
+} PhaseTime;
+
+typedef struct {
+    StatsMode mode;
+    PhaseTime phases[PHASE_COUNT];
+    size_t input_bytes;
+    size_t tokens;
+    size_t nodes[AST_KIND_COUNT];
+    ArenaStats arena;
+    int diagnostics;
+} CompileStats;
+
+void stats_init(CompileStats *st);
+/* Recognizes -Xtime and -Xstats=json; returns 1 if arg was consumed. */
+int stats_parse_flag(CompileStats *st, const char *arg);
+void stats_begin(CompileStats *st, Phase phase);
+void stats_end(CompileStats *st, Phase phase);
+/* Copies token, node, arena and diagnostic counts out of a finished parse. */
+void stats_collect(CompileStats *st, const Parser *ps, const Diag *diag);
+const char *stats_phase_name(Phase phase);
+const char *stats_ast_kind_name(AstKind kind);
+void stats_print(const CompileStats *st, FILE *out);
+
+#endif
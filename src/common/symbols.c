@@ -0,0 +1,200 @@
+#include "symbols.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "type_check.h"
+
+static size_t symbol_hash(SymbolKind kind, Str owner, Str name) {
+    uint64_t h = 14695981039346656037ull ^ (uint64_t)kind;
+    for (size_t i = 0; i < owner.len; i++) {
+        h = (h ^ (unsigned char)owner.data[i]) * 1099511628211ull;
+    }
+    h = (h ^ '.') * 1099511628211ull;
+    for (size_t i = 0; i < name.len; i++) {
+        h = (h ^ (unsigned char)name.data[i]) * 1099511628211ull;
+    }
+    return (size_t)h;
+}
+
+static Symbol *symbols_slot(Symbol *slots, size_t cap, SymbolKind kind, Str owner, Str name, size_t hash) {
+    size_t i = hash & (cap - 1);
+    for (;;) {
+        Symbol *s = &slots[i];
+        if (!s->decl || (s->hash == hash && s->kind == kind && str_eq(s->owner, owner) && str_eq(s->name, name))) {
+            return s;
+        }
+        i = (i + 1) & (cap - 1);
+    }
+}
+
+void symbols_init(SymbolIndex *ix) {
+    memset(ix, 0, sizeof(*ix));
+}
+
+void symbols_free(SymbolIndex *ix) {
+    free(ix->slots);
+    memset(ix, 0, sizeof(*ix));
+}
+
+/* Keeps the table at most half full. */
+static int symbols_grow(SymbolIndex *ix) {
+    if ((ix->count + 1) * 2 <= ix->cap) {
+        return 1;
+    }
+    size_t cap = ix->cap ? ix->cap * 2 : 256;
+    Symbol *slots = (Symbol *)calloc(cap, sizeof(Symbol));
+    if (!slots) {
+        return 0;
+    }
+    for (size_t i = 0; i < ix->cap; i++) {
+        Symbol *s = &ix->slots[i];
+        if (s->decl) {
+            *symbols_slot(slots, cap, s->kind, s->owner, s->name, s->hash) = *s;
+        }
+    }
+    free(ix->slots);
+    ix->slots = slots;
+    ix->cap = cap;
+    return 1;
+}
+
+static const char *kind_name(SymbolKind kind) {
+    switch (kind) {
+        case SYM_CLASS: return "class";
+        case SYM_FIELD: return "field";
+        default: return "method";
+    }
+}
+
+static int symbols_add(SymbolIndex *ix, SymbolKind kind, Str owner, Str name, Ast *decl, const char *path, Diag *diag) {
+    if (!symbols_grow(ix)) {
+        diag_error(diag, decl->tok.pos, "out of memory");
+        return 0;
+    }
+    size_t hash = symbol_hash(kind, owner, name);
+    Symbol *s = symbols_slot(ix->slots, ix->cap, kind, owner, name, hash);
+    if (s->decl) {
+        const char *sep = owner.len ? "." : "";
+        diag_error(diag, decl->tok.pos, "duplicate %s '%.*s%s%.*s', first declared in %s", kind_name(kind),
+                   (int)owner.len, owner.data, sep, (int)name.len, name.data, s->path ? s->path : "<input>");
+        return 0;
+    }
+    s->kind = kind;
+    s->owner = owner;
+    s->name = name;
+    s->decl = decl;
+    s->path = path;
+    s->hash = hash;
+    ix->count++;
+    return 1;
+}
+
+int symbols_add_unit(SymbolIndex *ix, Ast *comp_unit, const char *path, Diag *diag) {
+    if (!comp_unit) {
+        return 0;
+    }
+    Str none = {"", 0};
+    int ok = 1;
+    for (Ast *clazz = comp_unit->as.comp_unit.clazz; clazz; clazz = clazz->next) {
+        Str owner = clazz->as.class_decl.name;
+        ok &= symbols_add(ix, SYM_CLASS, none, owner, clazz, path, diag);
+        for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+            if (member->kind == AST_FIELD) {
+                ok &= symbols_add(ix, SYM_FIELD, owner, member->as.field_decl.name, member, path, diag);
+                continue;
+            }
+            if (member->kind != AST_METHOD) {
+                continue;
+            }
+            ok &= symbols_add(ix, SYM_METHOD, owner, member->as.method_decl.name, member, path, diag);
+            if (type_check_is_main(member) && !ix->main_class) {
+                ix->main_class = clazz;
+            }
+        }
+    }
+    return ok;
+}
+
+int symbols_scan_file(SymbolIndex *ix, const char *path, const char *src, size_t len, Arena *arena, Diag *diag) {
+    Parser ps;
+    parser_init(&ps, src, len, diag, arena);
+    Ast *unit = parse_declarations(&ps);
+    parser_free(&ps);
+    if (!unit || diag->had_error) {
+        return 0;
+    }
+    return symbols_add_unit(ix, unit, path, diag);
+}
+
+int symbols_scan_fd(SymbolIndex *ix, const char *path, int fd, Arena *arena, Diag *diag) {
+    Parser ps;
+    parser_init_fd(&ps, fd, diag, arena);
+    Ast *unit = parse_declarations(&ps);
+    parser_free(&ps);
+    if (!unit || diag->had_error) {
+        return 0;
+    }
+    return symbols_add_unit(ix, unit, path, diag);
+}
+
+static const Symbol *symbols_find_local(const SymbolIndex *ix, SymbolKind kind, Str owner, Str name) {
+    if (!ix->cap) {
+        return NULL;
+    }
+    Symbol *s = symbols_slot(ix->slots, ix->cap, kind, owner, name, symbol_hash(kind, owner, name));
+    return s->decl ? s : NULL;
+}
+
+const Symbol *symbols_find(const SymbolIndex *ix, SymbolKind kind, Str owner, Str name) {
+    Str none = {"", 0};
+    for (; ix; ix = ix->parent) {
+        const Symbol *s = symbols_find_local(ix, kind, owner, name);
+        if (s) {
+            return s;
+        }
+        if (kind != SYM_CLASS && symbols_find_local(ix, SYM_CLASS, none, owner)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+size_t symbols_id(const SymbolIndex *ix, const Symbol *s) {
+    size_t base = 0;
+    for (; ix; ix = ix->parent) {
+        if (s >= ix->slots && s < ix->slots + ix->cap) {
+            return base + (size_t)(s - ix->slots);
+        }
+        base += ix->cap;
+    }
+    return base;
+}
+
+const Symbol *symbols_at(const SymbolIndex *ix, size_t id) {
+    for (; ix; ix = ix->parent) {
+        if (id < ix->cap) {
+            return &ix->slots[id];
+        }
+        id -= ix->cap;
+    }
+    return NULL;
+}
+
+Ast *symbols_find_method(const SymbolIndex *ix, Str clazz, Str callee) {
+    Str owner = clazz;
+    Str name = callee;
+    for (size_t i = callee.len; i > 0; i--) {
+        if (callee.data[i - 1] == '.') {
+            owner.data = callee.data;
+            owner.len = i - 1;
+            name.data = callee.data + i;
+            name.len = callee.len - i;
+            break;
+        }
+    }
+    const Symbol *s = symbols_find(ix, SYM_METHOD, owner, name);
+    return s ? s->decl : NULL;
+}
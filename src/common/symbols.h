@@ -0,0 +1,71 @@
+#ifndef TINYJVM_SYMBOLS_H
+#define TINYJVM_SYMBOLS_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+#include "diag.h"
+
+/*
+ * Project-wide index of classes, fields and methods, filled from a
+ * declarations-only pre-pass over every input file before any body is
+ * checked. Entries live in one open-addressed hash table keyed by kind,
+ * owning class and name, so building it and resolving against it both
+ * stay linear in the total input. Declarations point into the sources and
+ * the arena the pre-pass parsed into, which must outlive the index; from
+ * symbols_scan_fd they point only into the arena.
+ */
+typedef enum {
+    SYM_CLASS,
+    SYM_FIELD,
+    SYM_METHOD
+} SymbolKind;
+
+typedef struct {
+    SymbolKind kind;
+    Str owner; /* empty for classes */
+    Str name;
+    Ast *decl; /* NULL marks an empty slot */
+    const char *path;
+    size_t hash;
+} Symbol;
+
+/*
+ * An index may fall back to a parent, e.g. one file's fresh declarations
+ * over the project's. A class declared in the child hides everything the
+ * parent holds for it, so members removed from the child are gone.
+ */
+typedef struct SymbolIndex {
+    Symbol *slots;
+    size_t cap;
+    size_t count;
+    Ast *main_class; /* first class seen with static main */
+    const struct SymbolIndex *parent;
+} SymbolIndex;
+
+void symbols_init(SymbolIndex *ix);
+void symbols_free(SymbolIndex *ix);
+
+/* Adds every class of comp_unit and its members; duplicates are reported on diag. */
+int symbols_add_unit(SymbolIndex *ix, Ast *comp_unit, const char *path, Diag *diag);
+
+/* Runs the declarations-only parse over src and indexes the result. */
+int symbols_scan_file(SymbolIndex *ix, const char *path, const char *src, size_t len, Arena *arena, Diag *diag);
+
+/*
+ * The same over fd, read to its end. Names are copied into arena and
+ * bodies are dropped as they are skipped, so arena grows with the
+ * declarations rather than the input.
+ */
+int symbols_scan_fd(SymbolIndex *ix, const char *path, int fd, Arena *arena, Diag *diag);
+
+const Symbol *symbols_find(const SymbolIndex *ix, SymbolKind kind, Str owner, Str name);
+
+/* A number for a found symbol that is unique across ix and its parents, and its inverse. */
+size_t symbols_id(const SymbolIndex *ix, const Symbol *s);
+const Symbol *symbols_at(const SymbolIndex *ix, size_t id);
+
+/* Resolves foo (a method of clazz) or Owner.foo; NULL if there is none. */
+Ast *symbols_find_method(const SymbolIndex *ix, Str clazz, Str callee);
+
+#endif
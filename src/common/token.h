@@ -18,6 +18,10 @@ typedef enum {
     TOK_KW_NEW,
     TOK_KW_RETURN,
     TOK_KW_VOID,
+    TOK_KW_IF,
+    TOK_KW_ELSE,
+    TOK_KW_WHILE,
+    TOK_KW_FOR,
 
     TOK_LBRACE,
     TOK_RBRACE,
@@ -34,7 +38,14 @@ typedef enum {
     TOK_MINUS,
     TOK_STAR,
     TOK_SLASH,
-    TOK_PERCENT
+    TOK_PERCENT,
+    TOK_EQ_EQ,
+    TOK_BANG_EQ,
+    TOK_LT,
+    TOK_LT_EQ,
+    TOK_GT,
+    TOK_GT_EQ,
+    TOK_COUNT
 } TokenType;
 
 typedef struct {
@@ -1,16 +1,30 @@
 #include "type_check.h"
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "str.h"
 
-typedef enum {
+enum {
     TYPE_INT,
     TYPE_STRING,
     TYPE_VOID,
     TYPE_STRING_ARRAY,
-    TYPE_UNKNOWN
-} TypeKind;
+    TYPE_BOOLEAN,
+    TYPE_UNKNOWN,
+    TYPE_OBJECT
+};
+
+/*
+ * Class types are TYPE_OBJECT for the enclosing class when there is no
+ * symbol index, and TYPE_OBJECT + 1 + the class's symbols_id when there
+ * is, so two types are the same exactly when they compare equal.
+ */
+typedef int TypeKind;
 
 typedef struct {
     Str name;
@@ -20,6 +34,9 @@ typedef struct {
 typedef struct {
     Local locals[256];
     int count;
+    TypeKind ret_type;
+    Ast *clazz;
+    const SymbolIndex *symbols;
 } LocalMap;
 
 static TypeKind type_from_str(Str s) {
@@ -30,14 +47,40 @@ static TypeKind type_from_str(Str s) {
     return TYPE_UNKNOWN;
 }
 
-static const char *type_name(TypeKind t) {
-    switch (t) {
-        case TYPE_INT: return "int";
-        case TYPE_STRING: return "String";
-        case TYPE_VOID: return "void";
-        case TYPE_STRING_ARRAY: return "String[]";
-        default: return "unknown";
+static int is_class_type(TypeKind t) {
+    return t >= TYPE_OBJECT;
+}
+
+static Str type_name(const LocalMap *m, TypeKind t) {
+    static const char *const names[] = {"int", "String", "void", "String[]", "boolean", "unknown"};
+    if (t == TYPE_OBJECT && m->clazz) {
+        return m->clazz->as.class_decl.name;
+    }
+    const Symbol *sym = t > TYPE_OBJECT && m->symbols ? symbols_at(m->symbols, (size_t)(t - TYPE_OBJECT - 1)) : NULL;
+    if (sym) {
+        return sym->name;
+    }
+    const char *name = t >= 0 && t < TYPE_OBJECT ? names[t] : "object";
+    Str out = {name, strlen(name)};
+    return out;
+}
+
+/* Any class in the symbol index is a type; without one, only the enclosing class is. */
+static TypeKind resolve_class(const LocalMap *m, Str name) {
+    if (m->symbols) {
+        Str none = {"", 0};
+        const Symbol *sym = symbols_find(m->symbols, SYM_CLASS, none, name);
+        if (sym) return TYPE_OBJECT + 1 + (TypeKind)symbols_id(m->symbols, sym);
+    }
+    if (m->clazz && str_eq(name, m->clazz->as.class_decl.name)) {
+        return TYPE_OBJECT;
     }
+    return TYPE_UNKNOWN;
+}
+
+static TypeKind resolve_type(LocalMap *m, Str s) {
+    TypeKind t = type_from_str(s);
+    return t == TYPE_UNKNOWN ? resolve_class(m, s) : t;
 }
 
 static int locals_add(LocalMap *m, Str name, TypeKind type) {
@@ -76,6 +119,149 @@ static int concat_foldable(Ast *expr) {
     }
 }
 
+typedef struct {
+    TypeKind type;
+    int foldable;
+} ExprType;
+
+static TypeKind check_expr(Ast *expr, Diag *diag, LocalMap *locals);
+
+static int is_comparison(TokenType op) {
+    switch (op) {
+        case TOK_EQ_EQ:
+        case TOK_BANG_EQ:
+        case TOK_LT:
+        case TOK_LT_EQ:
+        case TOK_GT:
+        case TOK_GT_EQ:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static TypeKind bin_type(Ast *expr, ExprType lhs, ExprType rhs, Diag *diag, LocalMap *locals) {
+    if (expr->as.bin.op == TOK_PLUS) {
+        if (lhs.type == TYPE_INT && rhs.type == TYPE_INT) return TYPE_INT;
+        if ((lhs.type == TYPE_STRING || rhs.type == TYPE_STRING) && lhs.foldable && rhs.foldable) {
+            return TYPE_STRING;
+        }
+        Str lt = type_name(locals, lhs.type);
+        Str rt = type_name(locals, rhs.type);
+        diag_error(diag, expr->tok.pos, "unsupported '+' operands (%.*s, %.*s)", (int)lt.len, lt.data, (int)rt.len, rt.data);
+        return TYPE_UNKNOWN;
+    }
+    if (is_comparison(expr->as.bin.op)) {
+        if (lhs.type == TYPE_INT && rhs.type == TYPE_INT) return TYPE_BOOLEAN;
+        diag_error(diag, expr->tok.pos, "comparison only supports int operands");
+        return TYPE_UNKNOWN;
+    }
+    if (lhs.type == TYPE_INT && rhs.type == TYPE_INT) return TYPE_INT;
+    diag_error(diag, expr->tok.pos, "binary operator only supports int operands");
+    return TYPE_UNKNOWN;
+}
+
+/*
+ * Walks the parser's post-order slice with an explicit stack so that deeply
+ * nested expressions don't recurse. Nodes built without a slice fall back
+ * to the recursive walk.
+ */
+static TypeKind check_bin(Ast *expr, Diag *diag, LocalMap *locals) {
+    if (!expr->as.bin.post) {
+        ExprType lhs = {check_expr(expr->as.bin.lhs, diag, locals), concat_foldable(expr->as.bin.lhs)};
+        ExprType rhs = {check_expr(expr->as.bin.rhs, diag, locals), concat_foldable(expr->as.bin.rhs)};
+        return bin_type(expr, lhs, rhs, diag, locals);
+    }
+    ExprType small[32];
+    ExprType *stack = small;
+    size_t n = expr->as.bin.post_len;
+    if (n > 32) {
+        stack = (ExprType *)malloc(n * sizeof(ExprType));
+        if (!stack) {
+            diag_error(diag, expr->tok.pos, "out of memory");
+            return TYPE_UNKNOWN;
+        }
+    }
+    size_t depth = 0;
+    for (size_t i = 0; i < n; i++) {
+        Ast *node = expr->as.bin.post[i];
+        if (node->kind != AST_BIN) {
+            stack[depth].type = check_expr(node, diag, locals);
+            stack[depth].foldable = node->kind == AST_INT_LIT || node->kind == AST_STRING_LIT;
+            depth++;
+            continue;
+        }
+        ExprType rhs = stack[--depth];
+        ExprType lhs = stack[--depth];
+        stack[depth].type = bin_type(node, lhs, rhs, diag, locals);
+        stack[depth].foldable = node->as.bin.op == TOK_PLUS && lhs.foldable && rhs.foldable;
+        depth++;
+    }
+    TypeKind result = depth == 1 ? stack[0].type : TYPE_UNKNOWN;
+    if (stack != small) {
+        free(stack);
+    }
+    return result;
+}
+
+static TypeKind check_println(Ast *expr, Diag *diag, LocalMap *locals) {
+    Ast *arg = expr->as.call.args;
+    if (!arg) return TYPE_VOID;
+    if (arg->next) {
+        diag_error(diag, expr->tok.pos, "println expects zero or one argument");
+        return TYPE_UNKNOWN;
+    }
+    TypeKind at = check_expr(arg, diag, locals);
+    if (at != TYPE_INT && at != TYPE_STRING) {
+        diag_error(diag, expr->tok.pos, "println argument must be int or String");
+    }
+    return TYPE_VOID;
+}
+
+static Ast *resolve_method(LocalMap *locals, Str callee) {
+    if (locals->symbols && locals->clazz) {
+        return symbols_find_method(locals->symbols, locals->clazz->as.class_decl.name, callee);
+    }
+    return ast_find_method(locals->clazz, callee);
+}
+
+static TypeKind check_call(Ast *expr, Diag *diag, LocalMap *locals) {
+    Str callee = expr->as.call.callee;
+    if (str_eq_c(callee, "System.out.println")) {
+        return check_println(expr, diag, locals);
+    }
+    Ast *method = resolve_method(locals, callee);
+    if (!method) {
+        diag_error(diag, expr->tok.pos, "unknown method '%.*s'", (int)callee.len, callee.data);
+        return TYPE_UNKNOWN;
+    }
+    if (!method->as.method_decl.is_static) {
+        diag_error(diag, expr->tok.pos, "call to non-static method '%.*s' is not supported", (int)callee.len, callee.data);
+        return TYPE_UNKNOWN;
+    }
+    Ast *param = method->as.method_decl.params;
+    Ast *arg = expr->as.call.args;
+    int index = 1;
+    for (; param && arg; param = param->next, arg = arg->next, index++) {
+        TypeKind at = check_expr(arg, diag, locals);
+        TypeKind pt = resolve_type(locals, param->as.var_decl.type);
+        if (at != TYPE_UNKNOWN && pt != TYPE_UNKNOWN && at != pt) {
+            Str want = type_name(locals, pt);
+            Str got = type_name(locals, at);
+            diag_error(diag, arg->tok.pos, "argument %d of '%.*s' must be '%.*s', not '%.*s'", index, (int)callee.len, callee.data,
+                       (int)want.len, want.data, (int)got.len, got.data);
+        }
+    }
+    if (param || arg) {
+        int expected = index - 1;
+        int got = index - 1;
+        for (; param; param = param->next) expected++;
+        for (; arg; arg = arg->next) got++;
+        diag_error(diag, expr->tok.pos, "'%.*s' expects %d argument(s), got %d", (int)callee.len, callee.data, expected, got);
+    }
+    return resolve_type(locals, method->as.method_decl.ret_type);
+}
+
 static TypeKind check_expr(Ast *expr, Diag *diag, LocalMap *locals) {
     if (!expr) return TYPE_UNKNOWN;
     switch (expr->kind) {
@@ -90,38 +276,17 @@ static TypeKind check_expr(Ast *expr, Diag *diag, LocalMap *locals) {
             }
             return t;
         }
-        case AST_BIN: {
-            TypeKind lt = check_expr(expr->as.bin.lhs, diag, locals);
-            TypeKind rt = check_expr(expr->as.bin.rhs, diag, locals);
-            if (expr->as.bin.op == TOK_PLUS) {
-                if (lt == TYPE_INT && rt == TYPE_INT) return TYPE_INT;
-                if ((lt == TYPE_STRING || rt == TYPE_STRING) && concat_foldable(expr)) {
-                    return TYPE_STRING;
-                }
-                diag_error(diag, expr->tok.pos, "unsupported '+' operands (%s, %s)", type_name(lt), type_name(rt));
-                return TYPE_UNKNOWN;
-            }
-            if (lt == TYPE_INT && rt == TYPE_INT) return TYPE_INT;
-            diag_error(diag, expr->tok.pos, "binary operator only supports int operands");
-            return TYPE_UNKNOWN;
-        }
-        case AST_CALL: {
-            Str callee = expr->as.call.callee;
-            if (!str_eq_c(callee, "System.out.println")) {
-                diag_error(diag, expr->tok.pos, "unsupported call '%.*s'", (int)callee.len, callee.data);
-                return TYPE_UNKNOWN;
-            }
-            Ast *arg = expr->as.call.args;
-            if (!arg) return TYPE_VOID;
-            if (arg->next) {
-                diag_error(diag, expr->tok.pos, "println expects zero or one argument");
-                return TYPE_UNKNOWN;
-            }
-            TypeKind at = check_expr(arg, diag, locals);
-            if (at != TYPE_INT && at != TYPE_STRING) {
-                diag_error(diag, expr->tok.pos, "println argument must be int or String");
+        case AST_BIN:
+            return check_bin(expr, diag, locals);
+        case AST_CALL:
+            return check_call(expr, diag, locals);
+        case AST_NEW: {
+            Str name = expr->as.new_expr.class_name;
+            TypeKind t = resolve_class(locals, name);
+            if (t == TYPE_UNKNOWN) {
+                diag_error(diag, expr->tok.pos, "unknown class '%.*s'", (int)name.len, name.data);
             }
-            return TYPE_VOID;
+            return t;
         }
         default:
             diag_error(diag, expr->tok.pos, "unsupported expression");
@@ -129,6 +294,29 @@ static TypeKind check_expr(Ast *expr, Diag *diag, LocalMap *locals) {
     }
 }
 
+static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals);
+
+static void type_mismatch(Diag *diag, size_t pos, LocalMap *locals, TypeKind from, TypeKind to, const char *how) {
+    Str f = type_name(locals, from);
+    Str t = type_name(locals, to);
+    diag_error(diag, pos, "type mismatch: '%.*s' cannot be %s '%.*s'", (int)f.len, f.data, how, (int)t.len, t.data);
+}
+
+static void check_cond(Ast *cond, Diag *diag, LocalMap *locals) {
+    TypeKind t = check_expr(cond, diag, locals);
+    if (t != TYPE_BOOLEAN && t != TYPE_UNKNOWN) {
+        Str name = type_name(locals, t);
+        diag_error(diag, cond->tok.pos, "condition must be a comparison, not '%.*s'", (int)name.len, name.data);
+    }
+}
+
+/* Checks stmt in its own scope: locals declared inside are dropped afterwards. */
+static void check_scoped(Ast *stmt, Diag *diag, LocalMap *locals) {
+    int count = locals->count;
+    check_stmt(stmt, diag, locals);
+    locals->count = count;
+}
+
 static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals) {
     if (!stmt) return;
     switch (stmt->kind) {
@@ -137,7 +325,7 @@ static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals) {
                 diag_error(diag, stmt->tok.pos, "duplicate local '%.*s'", (int)stmt->as.var_decl.name.len, stmt->as.var_decl.name.data);
                 return;
             }
-            TypeKind var_type = type_from_str(stmt->as.var_decl.type);
+            TypeKind var_type = resolve_type(locals, stmt->as.var_decl.type);
             if (var_type == TYPE_UNKNOWN || var_type == TYPE_VOID || var_type == TYPE_STRING_ARRAY) {
                 diag_error(diag, stmt->tok.pos, "unsupported local type '%.*s'", (int)stmt->as.var_decl.type.len, stmt->as.var_decl.type.data);
                 return;
@@ -149,7 +337,7 @@ static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals) {
             if (stmt->as.var_decl.init) {
                 TypeKind init_type = check_expr(stmt->as.var_decl.init, diag, locals);
                 if (init_type != TYPE_UNKNOWN && init_type != var_type) {
-                    diag_error(diag, stmt->tok.pos, "type mismatch: '%s' cannot be assigned to '%s'", type_name(init_type), type_name(var_type));
+                    type_mismatch(diag, stmt->tok.pos, locals, init_type, var_type, "assigned to");
                 }
             }
         } break;
@@ -164,7 +352,7 @@ static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals) {
             }
             TypeKind rt = check_expr(stmt->as.assign.value, diag, locals);
             if (rt != TYPE_UNKNOWN && rt != lt) {
-                diag_error(diag, stmt->tok.pos, "type mismatch: '%s' cannot be assigned to '%s'", type_name(rt), type_name(lt));
+                type_mismatch(diag, stmt->tok.pos, locals, rt, lt, "assigned to");
             }
         } break;
         case AST_INC: {
@@ -173,18 +361,51 @@ static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals) {
                 diag_error(diag, stmt->tok.pos, "++ only supports int locals");
             }
         } break;
-        case AST_RETURN:
-            if (stmt->as.return_stmt.expr) {
-                diag_error(diag, stmt->tok.pos, "return expression not allowed in void method");
-                check_expr(stmt->as.return_stmt.expr, diag, locals);
+        case AST_RETURN: {
+            Ast *expr = stmt->as.return_stmt.expr;
+            if (locals->ret_type == TYPE_VOID) {
+                if (expr) {
+                    diag_error(diag, stmt->tok.pos, "return expression not allowed in void method");
+                    check_expr(expr, diag, locals);
+                }
+                break;
             }
-            break;
+            if (!expr) {
+                diag_error(diag, stmt->tok.pos, "missing return value");
+                break;
+            }
+            TypeKind rt = check_expr(expr, diag, locals);
+            if (rt != TYPE_UNKNOWN && locals->ret_type != TYPE_UNKNOWN && rt != locals->ret_type) {
+                type_mismatch(diag, stmt->tok.pos, locals, rt, locals->ret_type, "returned as");
+            }
+        } break;
         case AST_BLOCK: {
+            int count = locals->count;
             Ast *cur = stmt->as.block.stmts;
             while (cur) {
                 check_stmt(cur, diag, locals);
                 cur = cur->next;
             }
+            locals->count = count;
+        } break;
+        case AST_IF:
+            check_cond(stmt->as.if_stmt.cond, diag, locals);
+            check_scoped(stmt->as.if_stmt.then_branch, diag, locals);
+            check_scoped(stmt->as.if_stmt.else_branch, diag, locals);
+            break;
+        case AST_WHILE:
+            check_cond(stmt->as.while_stmt.cond, diag, locals);
+            check_scoped(stmt->as.while_stmt.body, diag, locals);
+            break;
+        case AST_FOR: {
+            int count = locals->count;
+            check_stmt(stmt->as.for_stmt.init, diag, locals);
+            if (stmt->as.for_stmt.cond) {
+                check_cond(stmt->as.for_stmt.cond, diag, locals);
+            }
+            check_scoped(stmt->as.for_stmt.update, diag, locals);
+            check_scoped(stmt->as.for_stmt.body, diag, locals);
+            locals->count = count;
         } break;
         default:
             diag_error(diag, stmt->tok.pos, "unsupported statement");
@@ -192,19 +413,165 @@ static void check_stmt(Ast *stmt, Diag *diag, LocalMap *locals) {
     }
 }
 
-static void check_main_body(Ast *method, Diag *diag) {
-    LocalMap locals;
-    locals.count = 0;
+/*
+ * Java's constant expressions, restricted to this subset: int literals
+ * joined by arithmetic and comparisons. Division by zero isn't constant.
+ */
+static int const_fold(TokenType op, int32_t a, int32_t b, int32_t *out) {
+    uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+    switch (op) {
+        case TOK_PLUS: *out = (int32_t)(ua + ub); return 1;
+        case TOK_MINUS: *out = (int32_t)(ua - ub); return 1;
+        case TOK_STAR: *out = (int32_t)(ua * ub); return 1;
+        case TOK_SLASH:
+            if (b == 0) return 0;
+            *out = b == -1 ? (int32_t)(0u - ua) : a / b;
+            return 1;
+        case TOK_PERCENT:
+            if (b == 0) return 0;
+            *out = b == -1 ? 0 : a % b;
+            return 1;
+        case TOK_EQ_EQ: *out = a == b; return 1;
+        case TOK_BANG_EQ: *out = a != b; return 1;
+        case TOK_LT: *out = a < b; return 1;
+        case TOK_LT_EQ: *out = a <= b; return 1;
+        case TOK_GT: *out = a > b; return 1;
+        case TOK_GT_EQ: *out = a >= b; return 1;
+        default: return 0;
+    }
+}
+
+static int const_value(Ast *expr, int32_t *out) {
+    if (expr->kind == AST_INT_LIT) {
+        *out = expr->as.int_lit.value;
+        return 1;
+    }
+    if (expr->kind != AST_BIN) return 0;
+    if (!expr->as.bin.post) {
+        int32_t a, b;
+        return const_value(expr->as.bin.lhs, &a) && const_value(expr->as.bin.rhs, &b) &&
+               const_fold(expr->as.bin.op, a, b, out);
+    }
+    int32_t small[32];
+    int32_t *stack = small;
+    size_t n = expr->as.bin.post_len;
+    if (n > 32) {
+        stack = (int32_t *)malloc(n * sizeof(int32_t));
+        if (!stack) return 0;
+    }
+    size_t depth = 0;
+    int constant = 1;
+    for (size_t i = 0; i < n && constant; i++) {
+        Ast *node = expr->as.bin.post[i];
+        if (node->kind != AST_BIN) {
+            constant = node->kind == AST_INT_LIT;
+            stack[depth++] = constant ? node->as.int_lit.value : 0;
+            continue;
+        }
+        int32_t b = stack[--depth];
+        int32_t a = stack[--depth];
+        constant = const_fold(node->as.bin.op, a, b, &stack[depth++]);
+    }
+    constant = constant && depth == 1;
+    if (constant) {
+        *out = stack[0];
+    }
+    if (stack != small) {
+        free(stack);
+    }
+    return constant;
+}
 
+static int is_const_true(Ast *cond) {
+    int32_t v;
+    return !cond || (const_value(cond, &v) && v);
+}
+
+/*
+ * Java's "can complete normally" rule for the statements this subset has.
+ * There is no break, so a loop whose condition is constantly true never
+ * completes, and an if completes unless both of its branches return.
+ */
+static int can_complete(Ast *stmt) {
+    if (!stmt) return 1;
+    switch (stmt->kind) {
+        case AST_RETURN:
+            return 0;
+        case AST_BLOCK:
+            for (Ast *s = stmt->as.block.stmts; s; s = s->next) {
+                if (!can_complete(s)) return 0;
+            }
+            return 1;
+        case AST_IF:
+            return !stmt->as.if_stmt.else_branch || can_complete(stmt->as.if_stmt.then_branch) ||
+                   can_complete(stmt->as.if_stmt.else_branch);
+        case AST_WHILE:
+            return !is_const_true(stmt->as.while_stmt.cond);
+        case AST_FOR:
+            return !is_const_true(stmt->as.for_stmt.cond);
+        default:
+            return 1;
+    }
+}
+
+static int is_main_method(Ast *method) {
+    return method->as.method_decl.is_static && str_eq_c(method->as.method_decl.name, "main");
+}
+
+static void check_main_signature(Ast *method, Diag *diag, LocalMap *locals) {
+    if (!str_eq_c(method->as.method_decl.ret_type, "void")) {
+        diag_error(diag, method->tok.pos, "main must return void");
+    }
     Ast *param = method->as.method_decl.params;
+    if (!param || param->next != NULL) {
+        diag_error(diag, method->tok.pos, "main must have one parameter");
+    }
+    locals->ret_type = TYPE_VOID;
     if (param) {
         TypeKind pt = type_from_str(param->as.var_decl.type);
         if (pt != TYPE_STRING_ARRAY) {
             diag_error(diag, param->tok.pos, "main parameter must be String[]");
         } else {
-            locals_add(&locals, param->as.var_decl.name, pt);
+            locals_add(locals, param->as.var_decl.name, pt);
+        }
+    }
+}
+
+static void check_signature(Ast *method, Diag *diag, LocalMap *locals) {
+    Str ret = method->as.method_decl.ret_type;
+    locals->ret_type = resolve_type(locals, ret);
+    if (locals->ret_type == TYPE_UNKNOWN || locals->ret_type == TYPE_STRING_ARRAY) {
+        diag_error(diag, method->tok.pos, "unsupported return type '%.*s'", (int)ret.len, ret.data);
+        locals->ret_type = TYPE_UNKNOWN;
+    }
+    for (Ast *param = method->as.method_decl.params; param; param = param->next) {
+        Str name = param->as.var_decl.name;
+        TypeKind pt = resolve_type(locals, param->as.var_decl.type);
+        if (pt != TYPE_INT && pt != TYPE_STRING && !is_class_type(pt)) {
+            diag_error(diag, param->tok.pos, "unsupported parameter type '%.*s'", (int)param->as.var_decl.type.len, param->as.var_decl.type.data);
+            continue;
+        }
+        if (locals_find(locals, name) >= 0) {
+            diag_error(diag, param->tok.pos, "duplicate parameter '%.*s'", (int)name.len, name.data);
+            continue;
+        }
+        if (locals_add(locals, name, pt) < 0) {
+            diag_error(diag, param->tok.pos, "too many locals");
         }
     }
+}
+
+static void check_method(Ast *clazz, Ast *method, const SymbolIndex *symbols, Diag *diag) {
+    LocalMap locals;
+    locals.count = 0;
+    locals.clazz = clazz;
+    locals.symbols = symbols;
+
+    if (is_main_method(method)) {
+        check_main_signature(method, diag, &locals);
+    } else {
+        check_signature(method, diag, &locals);
+    }
 
     if (method->as.method_decl.body) {
         Ast *stmt = method->as.method_decl.body->as.block.stmts;
@@ -212,39 +579,197 @@ static void check_main_body(Ast *method, Diag *diag) {
             check_stmt(stmt, diag, &locals);
             stmt = stmt->next;
         }
+        if (locals.ret_type != TYPE_VOID && locals.ret_type != TYPE_UNKNOWN &&
+            can_complete(method->as.method_decl.body)) {
+            diag_error(diag, method->tok.pos, "missing return statement");
+        }
     }
 }
 
+typedef struct {
+    Ast *clazz;
+    Ast *method;
+    Diag diag;
+} MethodJob;
+
+typedef struct {
+    const SymbolIndex *symbols;
+    MethodJob *jobs;
+    size_t count;
+    atomic_size_t next;
+    const TypeCheckOptions *opts;
+} JobQueue;
+
+typedef struct {
+    JobQueue *queue;
+    Arena scratch;
+    pthread_t thread;
+} Worker;
+
+static void *check_worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    JobQueue *q = w->queue;
+    for (;;) {
+        size_t i = atomic_fetch_add(&q->next, 1);
+        if (i >= q->count) {
+            break;
+        }
+        MethodJob *job = &q->jobs[i];
+        check_method(job->clazz, job->method, q->symbols, &job->diag);
+        if (!job->diag.had_error && q->opts->emit_method) {
+            q->opts->emit_method(job->method, i, &w->scratch, &job->diag, q->opts->user);
+        }
+    }
+    return NULL;
+}
+
+/* Runs workers[1..] on their own threads and workers[0] on the calling thread. */
+static void run_workers(Worker *workers, int threads) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 1u << 20);
+    int started = 1;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[i].thread, &attr, check_worker, &workers[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    pthread_attr_destroy(&attr);
+    check_worker(&workers[0]);
+    for (int i = 1; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+}
+
+static void check_field(Ast *field, Diag *diag) {
+    TypeKind ft = type_from_str(field->as.field_decl.type);
+    if (ft != TYPE_INT && ft != TYPE_STRING) {
+        diag_error(diag, field->tok.pos, "unsupported field type '%.*s'", (int)field->as.field_decl.type.len, field->as.field_decl.type.data);
+    }
+}
+
+int type_check_is_main(Ast *method) {
+    return method->kind == AST_METHOD && is_main_method(method);
+}
+
+int type_check_member(Ast *clazz, Ast *member, const SymbolIndex *symbols, Diag *diag) {
+    int before = diag->error_count;
+    if (member->kind == AST_FIELD) {
+        check_field(member, diag);
+    } else if (member->kind == AST_METHOD) {
+        check_method(clazz, member, symbols, diag);
+    }
+    return diag->error_count == before;
+}
+
 int type_check_comp_unit(Ast *comp_unit, Diag *diag) {
+    TypeCheckOptions opts = {0};
+    opts.threads = 1;
+    return type_check_comp_unit_opts(comp_unit, diag, &opts);
+}
+
+int type_check_comp_unit_opts(Ast *comp_unit, Diag *diag, const TypeCheckOptions *opts) {
     if (!comp_unit || comp_unit->kind != AST_COMP_UNIT || !comp_unit->as.comp_unit.clazz) {
         return 0;
     }
-    Ast *member = comp_unit->as.comp_unit.clazz->as.class_decl.members;
-    while (member) {
-        if (member->kind == AST_FIELD) {
-            TypeKind ft = type_from_str(member->as.field_decl.type);
-            if (ft != TYPE_INT && ft != TYPE_STRING) {
-                diag_error(diag, member->tok.pos, "unsupported field type '%.*s'", (int)member->as.field_decl.type.len, member->as.field_decl.type.data);
-            }
-        }
-        if (member->kind == AST_METHOD) {
-            Str name = member->as.method_decl.name;
-            Str ret = member->as.method_decl.ret_type;
-            Ast *params = member->as.method_decl.params;
-            int is_static = member->as.method_decl.is_static;
-            if (is_static && str_eq_c(name, "main")) {
-                if (!str_eq_c(ret, "void")) {
-                    diag_error(diag, member->tok.pos, "main must return void");
-                }
-                if (!params || params->next != NULL) {
-                    diag_error(diag, member->tok.pos, "main must have one parameter");
+    Ast *classes = comp_unit->as.comp_unit.clazz;
+
+    size_t count = 0;
+    for (Ast *clazz = classes; clazz; clazz = clazz->next) {
+        for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+            if (member->kind == AST_METHOD) {
+                count++;
+            }
+        }
+    }
+    MethodJob *jobs = NULL;
+    if (count) {
+        jobs = (MethodJob *)calloc(count, sizeof(MethodJob));
+        if (!jobs) {
+            diag_error(diag, comp_unit->tok.pos, "out of memory");
+            return 0;
+        }
+    }
+    int has_main = 0;
+    size_t n = 0;
+    for (Ast *clazz = classes; clazz; clazz = clazz->next) {
+        for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+            if (member->kind != AST_METHOD) {
+                continue;
+            }
+            jobs[n].clazz = clazz;
+            jobs[n].method = member;
+            diag_init_buffered(&jobs[n].diag, diag);
+            n++;
+            if (is_main_method(member)) {
+                has_main = 1;
+            }
+        }
+    }
+
+    /* Several classes in one file can call each other even without a project index. */
+    SymbolIndex unit_symbols;
+    symbols_init(&unit_symbols);
+    const SymbolIndex *symbols = opts->symbols;
+    if (!symbols && classes && classes->next) {
+        symbols_add_unit(&unit_symbols, comp_unit, diag->path, diag);
+        symbols = &unit_symbols;
+    }
+
+    JobQueue queue;
+    queue.symbols = symbols;
+    queue.jobs = jobs;
+    queue.count = count;
+    queue.opts = opts;
+    atomic_init(&queue.next, 0);
+
+    int threads = opts->threads < 1 ? 1 : opts->threads;
+    if ((size_t)threads > count) {
+        threads = count ? (int)count : 1;
+    }
+    Worker single;
+    Worker *workers = threads > 1 ? (Worker *)calloc((size_t)threads, sizeof(Worker)) : NULL;
+    if (!workers) {
+        workers = &single;
+        threads = 1;
+    }
+    for (int i = 0; i < threads; i++) {
+        workers[i].queue = &queue;
+        arena_init(&workers[i].scratch);
+    }
+    run_workers(workers, threads);
+
+    /* Merge in member order so output doesn't depend on scheduling. */
+    n = 0;
+    for (Ast *clazz = classes; clazz; clazz = clazz->next) {
+        for (Ast *member = clazz->as.class_decl.members; member; member = member->next) {
+            if (member->kind == AST_FIELD) {
+                check_field(member, diag);
+            }
+            if (member->kind == AST_METHOD) {
+                int ok = !jobs[n].diag.had_error;
+                diag_merge(diag, &jobs[n].diag);
+                if (ok && opts->merge_method) {
+                    opts->merge_method(member, n, opts->user);
                 }
-                check_main_body(member, diag);
-                return !diag->had_error;
+                n++;
             }
         }
-        member = member->next;
     }
-    diag_error(diag, comp_unit->tok.pos, "main method not found");
-    return 0;
+
+    for (int i = 0; i < threads; i++) {
+        arena_free(&workers[i].scratch);
+    }
+    if (workers != &single) {
+        free(workers);
+    }
+    free(jobs);
+    symbols_free(&unit_symbols);
+
+    if (!has_main && !opts->symbols) {
+        diag_error(diag, comp_unit->tok.pos, "main method not found");
+        return 0;
+    }
+    return !diag->had_error;
 }
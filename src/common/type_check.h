@@ -1,9 +1,46 @@
 #ifndef TINYJVM_TYPE_CHECK_H
 #define TINYJVM_TYPE_CHECK_H
 
+#include <stddef.h>
+#include "arena.h"
 #include "ast.h"
 #include "diag.h"
+#include "symbols.h"
+
+/*
+ * Methods are checked independently, optionally on a pool of threads.
+ * emit_method runs on the worker right after a method checks cleanly, with
+ * that worker's scratch arena and the method's buffered Diag. merge_method
+ * then runs on the calling thread in member order, while the scratch arenas
+ * are still alive, so per-method output can be appended deterministically.
+ */
+typedef void (*MethodEmitFn)(Ast *method, size_t index, Arena *scratch, Diag *diag, void *user);
+typedef void (*MethodMergeFn)(Ast *method, size_t index, void *user);
+
+/*
+ * With symbols set, calls resolve through the project index, so they can
+ * reach other classes and files, and main is left to the driver to check
+ * project-wide. Without it calls resolve within the method's own class.
+ */
+typedef struct {
+    int threads;
+    const SymbolIndex *symbols;
+    MethodEmitFn emit_method;
+    MethodMergeFn merge_method;
+    void *user;
+} TypeCheckOptions;
 
 int type_check_comp_unit(Ast *comp_unit, Diag *diag);
+int type_check_comp_unit_opts(Ast *comp_unit, Diag *diag, const TypeCheckOptions *opts);
+
+/*
+ * Single-member entry points for the streaming pipeline. Calls resolve
+ * through symbols when given, else against the methods currently on
+ * clazz->members.
+ */
+int type_check_member(Ast *clazz, Ast *member, const SymbolIndex *symbols, Diag *diag);
+
+/* Whether member is the entry point, a static method named main. */
+int type_check_is_main(Ast *method);
 
 #endif
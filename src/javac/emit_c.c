@@ -0,0 +1,1061 @@
+#include "emit_c.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Expressions larger than this, or with more than one side effect, are lowered to temporaries. */
+#define EMIT_C_MAX_INLINE 64
+
+typedef enum {
+    CT_INT,
+    CT_STRING,
+    CT_BOOL,
+    CT_VOID,
+    CT_ARGS,
+    CT_OBJECT
+} CType;
+
+typedef struct {
+    Str name;
+    CType type;
+} CLocal;
+
+typedef struct {
+    FILE *out;
+    Diag *diag;
+    Ast *clazz;
+    CLocal *locals;
+    int local_count;
+    int local_cap;
+    Ast **live; /* methods reachable from main, in discovery order */
+    int live_count;
+    int live_cap;
+    int indent;
+    unsigned temps;
+    int failed;
+} EmitC;
+
+typedef enum {
+    OP_VOID,
+    OP_INT,
+    OP_LOCAL,
+    OP_STRING,
+    OP_TEMP
+} OperandKind;
+
+/* A lowered value: a literal, a local, a string constant (folded on output) or a temporary. */
+typedef struct {
+    OperandKind kind;
+    int32_t value;
+    Str name;
+    Ast *string;
+    unsigned temp;
+} Operand;
+
+typedef struct {
+    int is_str;
+    int32_t num;
+    char *s;
+    size_t len;
+    size_t cap;
+} FoldVal;
+
+static const char prelude[] =
+    "#include <inttypes.h>\n"
+    "#include <stdint.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "/* Java strings may contain '\\0', so they carry their length. */\n"
+    "typedef struct {\n"
+    "    const char *data;\n"
+    "    size_t length;\n"
+    "} jrt_string;\n"
+    "\n"
+    "#define JRT_STR(lit) ((jrt_string){lit, sizeof(lit) - 1})\n"
+    "#define JRT_NULL ((jrt_string){NULL, 0})\n"
+    "\n"
+    "typedef struct {\n"
+    "    int32_t length;\n"
+    "    char **data;\n"
+    "} jrt_string_array;\n"
+    "\n"
+    "static inline void jrt_throw(const char *name, const char *msg) {\n"
+    "    fflush(stdout);\n"
+    "    fprintf(stderr, \"Exception in thread \\\"main\\\" %s: %s\\n\", name, msg);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static inline int32_t jrt_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }\n"
+    "static inline int32_t jrt_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }\n"
+    "static inline int32_t jrt_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }\n"
+    "\n"
+    "static inline int32_t jrt_div(int32_t a, int32_t b) {\n"
+    "    if (b == 0) jrt_throw(\"java.lang.ArithmeticException\", \"/ by zero\");\n"
+    "    if (b == -1) return jrt_sub(0, a);\n"
+    "    return a / b;\n"
+    "}\n"
+    "\n"
+    "static inline int32_t jrt_rem(int32_t a, int32_t b) {\n"
+    "    if (b == 0) jrt_throw(\"java.lang.ArithmeticException\", \"/ by zero\");\n"
+    "    if (b == -1) return 0;\n"
+    "    return a % b;\n"
+    "}\n"
+    "\n"
+    "/* Objects live until exit; there is no collector. */\n"
+    "static inline void *jrt_new(size_t size) {\n"
+    "    void *p = calloc(1, size);\n"
+    "    if (!p) jrt_throw(\"java.lang.OutOfMemoryError\", \"Java heap space\");\n"
+    "    return p;\n"
+    "}\n"
+    "\n"
+    "static inline void jrt_println(void) { putchar('\\n'); }\n"
+    "static inline void jrt_println_int(int32_t v) { printf(\"%\" PRId32 \"\\n\", v); }\n"
+    "static inline void jrt_println_str(jrt_string s) {\n"
+    "    if (!s.data) s = JRT_STR(\"null\");\n"
+    "    fwrite(s.data, 1, s.length, stdout);\n"
+    "    putchar('\\n');\n"
+    "}\n";
+
+static void emit_fail(EmitC *ec, Ast *node, const char *what) {
+    diag_error(ec->diag, node->tok.pos, "C backend: unsupported %s", what);
+    ec->failed = 1;
+}
+
+static void emit_indent(EmitC *ec) {
+    for (int i = 0; i < ec->indent; i++) {
+        fputs("    ", ec->out);
+    }
+}
+
+/* Java identifiers may contain '$'; '_' is doubled so the mapping stays one-to-one. */
+static void emit_name(EmitC *ec, const char *prefix, Str name) {
+    fputs(prefix, ec->out);
+    for (size_t i = 0; i < name.len; i++) {
+        char c = name.data[i];
+        if (c == '_') {
+            fputs("__", ec->out);
+        } else if (c == '$') {
+            fputs("_S", ec->out);
+        } else {
+            fputc(c, ec->out);
+        }
+    }
+}
+
+static void emit_c_string(EmitC *ec, const char *s, size_t len) {
+    fputc('"', ec->out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\' || c == '?') {
+            fprintf(ec->out, "\\%c", c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            fprintf(ec->out, "\\%03o", c);
+        } else {
+            fputc(c, ec->out);
+        }
+    }
+    fputc('"', ec->out);
+}
+
+static void emit_int(EmitC *ec, int32_t v) {
+    if (v == INT32_MIN) {
+        fputs("(-2147483647 - 1)", ec->out);
+    } else {
+        fprintf(ec->out, "%ld", (long)v);
+    }
+}
+
+static const char *ctype_name(CType t) {
+    switch (t) {
+        case CT_INT: return "int32_t";
+        case CT_STRING: return "jrt_string";
+        case CT_BOOL: return "int";
+        case CT_ARGS: return "jrt_string_array";
+        default: return "void";
+    }
+}
+
+static CType ctype_from_str(EmitC *ec, Str s) {
+    if (str_eq_c(s, "int")) return CT_INT;
+    if (str_eq_c(s, "String")) return CT_STRING;
+    if (str_eq_c(s, "String[]")) return CT_ARGS;
+    if (str_eq(s, ec->clazz->as.class_decl.name)) return CT_OBJECT;
+    return CT_VOID;
+}
+
+/* Other classes' types come from the project index, which this backend doesn't take. */
+static int check_ctype(EmitC *ec, Ast *node, Str s) {
+    if (ctype_from_str(ec, s) != CT_VOID || str_eq_c(s, "void")) return 1;
+    diag_error(ec->diag, node->tok.pos, "C backend: unsupported type '%.*s'", (int)s.len, s.data);
+    ec->failed = 1;
+    return 0;
+}
+
+static void emit_struct_name(EmitC *ec) {
+    fputs("struct ", ec->out);
+    emit_name(ec, "c_", ec->clazz->as.class_decl.name);
+}
+
+/* Returns 1 when the type ends in '*', so no space is needed before a name. */
+static int emit_type(EmitC *ec, CType t) {
+    if (t == CT_OBJECT) {
+        emit_struct_name(ec);
+        fputs(" *", ec->out);
+        return 1;
+    }
+    const char *type = ctype_name(t);
+    fputs(type, ec->out);
+    return type[strlen(type) - 1] == '*';
+}
+
+static void emit_decl(EmitC *ec, CType t, const char *prefix, Str name) {
+    if (!emit_type(ec, t)) {
+        fputc(' ', ec->out);
+    }
+    emit_name(ec, prefix, name);
+}
+
+static void locals_push(EmitC *ec, Str name, CType type) {
+    if (ec->local_count == ec->local_cap) {
+        int cap = ec->local_cap ? ec->local_cap * 2 : 32;
+        CLocal *grown = (CLocal *)realloc(ec->locals, (size_t)cap * sizeof(CLocal));
+        if (!grown) {
+            ec->failed = 1;
+            return;
+        }
+        ec->locals = grown;
+        ec->local_cap = cap;
+    }
+    ec->locals[ec->local_count].name = name;
+    ec->locals[ec->local_count].type = type;
+    ec->local_count++;
+}
+
+static CType locals_type(EmitC *ec, Str name) {
+    for (int i = ec->local_count - 1; i >= 0; i--) {
+        if (str_eq(ec->locals[i].name, name)) {
+            return ec->locals[i].type;
+        }
+    }
+    return CT_INT;
+}
+
+static int is_comparison(TokenType op) {
+    return op == TOK_EQ_EQ || op == TOK_BANG_EQ || op == TOK_LT || op == TOK_LT_EQ || op == TOK_GT || op == TOK_GT_EQ;
+}
+
+static const char *arith_fn(TokenType op) {
+    switch (op) {
+        case TOK_PLUS: return "jrt_add";
+        case TOK_MINUS: return "jrt_sub";
+        case TOK_STAR: return "jrt_mul";
+        case TOK_SLASH: return "jrt_div";
+        case TOK_PERCENT: return "jrt_rem";
+        default: return NULL;
+    }
+}
+
+static const char *compare_op(TokenType op) {
+    switch (op) {
+        case TOK_EQ_EQ: return "==";
+        case TOK_BANG_EQ: return "!=";
+        case TOK_LT: return "<";
+        case TOK_LT_EQ: return "<=";
+        case TOK_GT: return ">";
+        default: return ">=";
+    }
+}
+
+/* The checker only lets '+' reach a String when every operand is a literal, so a string literal anywhere means a constant. */
+static int is_string_bin(Ast *expr) {
+    if (is_comparison(expr->as.bin.op)) return 0;
+    if (!expr->as.bin.post) {
+        Ast *lhs = expr->as.bin.lhs;
+        Ast *rhs = expr->as.bin.rhs;
+        return lhs->kind == AST_STRING_LIT || rhs->kind == AST_STRING_LIT ||
+               (lhs->kind == AST_BIN && is_string_bin(lhs)) || (rhs->kind == AST_BIN && is_string_bin(rhs));
+    }
+    for (size_t i = 0; i < expr->as.bin.post_len; i++) {
+        if (expr->as.bin.post[i]->kind == AST_STRING_LIT) return 1;
+    }
+    return 0;
+}
+
+static Ast *find_callee(EmitC *ec, Ast *call) {
+    return ast_find_method(ec->clazz, call->as.call.callee);
+}
+
+static int is_println(Ast *call) {
+    return str_eq_c(call->as.call.callee, "System.out.println");
+}
+
+static CType expr_type(EmitC *ec, Ast *expr) {
+    switch (expr->kind) {
+        case AST_INT_LIT: return CT_INT;
+        case AST_STRING_LIT: return CT_STRING;
+        case AST_IDENT: return locals_type(ec, expr->as.ident.name);
+        case AST_BIN:
+            if (is_comparison(expr->as.bin.op)) return CT_BOOL;
+            return is_string_bin(expr) ? CT_STRING : CT_INT;
+        case AST_CALL: {
+            if (is_println(expr)) return CT_VOID;
+            Ast *method = find_callee(ec, expr);
+            return method ? ctype_from_str(ec, method->as.method_decl.ret_type) : CT_VOID;
+        }
+        case AST_NEW:
+            return CT_OBJECT;
+        default:
+            return CT_VOID;
+    }
+}
+
+static void fold_to_string(FoldVal *v) {
+    if (v->is_str) return;
+    char digits[16];
+    int n = snprintf(digits, sizeof(digits), "%ld", (long)v->num);
+    v->s = (char *)malloc(16);
+    if (v->s) memcpy(v->s, digits, (size_t)n);
+    v->len = v->s ? (size_t)n : 0;
+    v->cap = v->s ? 16 : 0;
+    v->is_str = 1;
+}
+
+static int fold_append(FoldVal *dst, FoldVal *src) {
+    fold_to_string(src);
+    if (dst->len + src->len > dst->cap) {
+        size_t cap = dst->cap ? dst->cap : 16;
+        while (cap < dst->len + src->len) cap *= 2;
+        char *grown = (char *)realloc(dst->s, cap);
+        if (!grown) return 0;
+        dst->s = grown;
+        dst->cap = cap;
+    }
+    if (src->len) memcpy(dst->s + dst->len, src->s, src->len);
+    dst->len += src->len;
+    free(src->s);
+    return 1;
+}
+
+static FoldVal fold_atom(Ast *atom) {
+    FoldVal v = {0, 0, NULL, 0, 0};
+    if (atom->kind == AST_INT_LIT) {
+        v.num = atom->as.int_lit.value;
+        return v;
+    }
+    v.is_str = 1;
+    Str s = atom->as.string_lit.value;
+    v.s = (char *)malloc(s.len ? s.len : 1);
+    if (v.s) memcpy(v.s, s.data, s.len);
+    v.len = v.s ? s.len : 0;
+    v.cap = v.len;
+    return v;
+}
+
+/* Java '+': int + int adds, anything else concatenates; lhs's buffer is grown in place. */
+static FoldVal fold_plus(FoldVal lhs, FoldVal rhs) {
+    if (!lhs.is_str && !rhs.is_str) {
+        lhs.num = (int32_t)((uint32_t)lhs.num + (uint32_t)rhs.num);
+        return lhs;
+    }
+    fold_to_string(&lhs);
+    fold_append(&lhs, &rhs);
+    return lhs;
+}
+
+static FoldVal fold_tree(Ast *expr) {
+    if (expr->kind != AST_BIN) return fold_atom(expr);
+    return fold_plus(fold_tree(expr->as.bin.lhs), fold_tree(expr->as.bin.rhs));
+}
+
+static void emit_string_const(EmitC *ec, Ast *expr) {
+    if (expr->kind == AST_STRING_LIT) {
+        fputs("JRT_STR(", ec->out);
+        emit_c_string(ec, expr->as.string_lit.value.data, expr->as.string_lit.value.len);
+        fputc(')', ec->out);
+        return;
+    }
+    FoldVal result;
+    if (!expr->as.bin.post) {
+        result = fold_tree(expr);
+    } else {
+        size_t n = expr->as.bin.post_len;
+        FoldVal *stack = (FoldVal *)malloc(n * sizeof(FoldVal));
+        if (!stack) {
+            ec->failed = 1;
+            return;
+        }
+        size_t depth = 0;
+        for (size_t i = 0; i < n; i++) {
+            Ast *node = expr->as.bin.post[i];
+            if (node->kind != AST_BIN) {
+                stack[depth++] = fold_atom(node);
+                continue;
+            }
+            FoldVal rhs = stack[--depth];
+            FoldVal lhs = stack[--depth];
+            stack[depth++] = fold_plus(lhs, rhs);
+        }
+        result = stack[0];
+        free(stack);
+    }
+    fold_to_string(&result);
+    fputs("JRT_STR(", ec->out);
+    emit_c_string(ec, result.s ? result.s : "", result.len);
+    fputc(')', ec->out);
+    free(result.s);
+}
+
+static void emit_operand(EmitC *ec, Operand op) {
+    switch (op.kind) {
+        case OP_INT: emit_int(ec, op.value); break;
+        case OP_LOCAL: emit_name(ec, "v_", op.name); break;
+        case OP_STRING: emit_string_const(ec, op.string); break;
+        case OP_TEMP: fprintf(ec->out, "t%u", op.temp); break;
+        default: break;
+    }
+}
+
+typedef struct {
+    int impure;
+    size_t nodes;
+} ExprCost;
+
+static void expr_cost(Ast *expr, ExprCost *cost) {
+    if (!expr || cost->nodes > EMIT_C_MAX_INLINE) return;
+    if (expr->kind == AST_BIN && expr->as.bin.post) {
+        cost->nodes += expr->as.bin.post_len;
+        for (size_t i = 0; i < expr->as.bin.post_len && cost->nodes <= EMIT_C_MAX_INLINE; i++) {
+            Ast *node = expr->as.bin.post[i];
+            if (node->kind == AST_BIN) {
+                cost->impure += node->as.bin.op == TOK_SLASH || node->as.bin.op == TOK_PERCENT;
+            } else if (node->kind == AST_CALL) {
+                cost->nodes--;
+                expr_cost(node, cost);
+            }
+        }
+        return;
+    }
+    cost->nodes++;
+    if (expr->kind == AST_BIN) {
+        cost->impure += expr->as.bin.op == TOK_SLASH || expr->as.bin.op == TOK_PERCENT;
+        expr_cost(expr->as.bin.lhs, cost);
+        expr_cost(expr->as.bin.rhs, cost);
+    } else if (expr->kind == AST_NEW) {
+        cost->impure++;
+    } else if (expr->kind == AST_CALL) {
+        cost->impure++;
+        for (Ast *arg = expr->as.call.args; arg; arg = arg->next) {
+            expr_cost(arg, cost);
+        }
+    }
+}
+
+static int needs_lowering(Ast *expr) {
+    ExprCost cost = {0, 0};
+    expr_cost(expr, &cost);
+    return cost.impure > 1 || cost.nodes > EMIT_C_MAX_INLINE;
+}
+
+static void emit_expr(EmitC *ec, Ast *expr);
+
+static void emit_call_args(EmitC *ec, Ast *call) {
+    fputc('(', ec->out);
+    for (Ast *arg = call->as.call.args; arg; arg = arg->next) {
+        emit_expr(ec, arg);
+        if (arg->next) fputs(", ", ec->out);
+    }
+    fputc(')', ec->out);
+}
+
+static const char *println_fn(EmitC *ec, Ast *call) {
+    Ast *arg = call->as.call.args;
+    if (!arg) return "jrt_println";
+    return expr_type(ec, arg) == CT_STRING ? "jrt_println_str" : "jrt_println_int";
+}
+
+/* Direct emission for small expressions with at most one side effect. */
+static void emit_expr(EmitC *ec, Ast *expr) {
+    switch (expr->kind) {
+        case AST_INT_LIT:
+            emit_int(ec, expr->as.int_lit.value);
+            break;
+        case AST_STRING_LIT:
+            emit_string_const(ec, expr);
+            break;
+        case AST_IDENT:
+            emit_name(ec, "v_", expr->as.ident.name);
+            break;
+        case AST_BIN:
+            if (is_comparison(expr->as.bin.op)) {
+                fputc('(', ec->out);
+                emit_expr(ec, expr->as.bin.lhs);
+                fprintf(ec->out, " %s ", compare_op(expr->as.bin.op));
+                emit_expr(ec, expr->as.bin.rhs);
+                fputc(')', ec->out);
+            } else if (is_string_bin(expr)) {
+                emit_string_const(ec, expr);
+            } else {
+                fprintf(ec->out, "%s(", arith_fn(expr->as.bin.op));
+                emit_expr(ec, expr->as.bin.lhs);
+                fputs(", ", ec->out);
+                emit_expr(ec, expr->as.bin.rhs);
+                fputc(')', ec->out);
+            }
+            break;
+        case AST_CALL: {
+            if (is_println(expr)) {
+                fputs(println_fn(ec, expr), ec->out);
+                emit_call_args(ec, expr);
+                break;
+            }
+            Ast *method = find_callee(ec, expr);
+            if (!method) {
+                emit_fail(ec, expr, "call");
+                break;
+            }
+            emit_name(ec, "j_", method->as.method_decl.name);
+            emit_call_args(ec, expr);
+        } break;
+        case AST_NEW:
+            if (!str_eq(expr->as.new_expr.class_name, ec->clazz->as.class_decl.name)) {
+                emit_fail(ec, expr, "allocation of another class");
+                break;
+            }
+            fputs("jrt_new(sizeof(", ec->out);
+            emit_struct_name(ec);
+            fputs("))", ec->out);
+            break;
+        default:
+            emit_fail(ec, expr, "expression");
+            break;
+    }
+}
+
+static Operand lower_expr(EmitC *ec, Ast *expr, int discard);
+
+static Operand new_temp(EmitC *ec, CType type) {
+    Operand op = {OP_TEMP, 0, {NULL, 0}, NULL, ++ec->temps};
+    emit_indent(ec);
+    if (!emit_type(ec, type)) {
+        fputc(' ', ec->out);
+    }
+    fprintf(ec->out, "t%u = ", op.temp);
+    return op;
+}
+
+static Operand lower_call(EmitC *ec, Ast *call, int discard) {
+    Operand none = {OP_VOID, 0, {NULL, 0}, NULL, 0};
+    size_t argc = 0;
+    for (Ast *arg = call->as.call.args; arg; arg = arg->next) {
+        argc++;
+    }
+    Operand *args = argc ? (Operand *)malloc(argc * sizeof(Operand)) : NULL;
+    if (argc && !args) {
+        ec->failed = 1;
+        return none;
+    }
+    size_t i = 0;
+    for (Ast *arg = call->as.call.args; arg; arg = arg->next) {
+        args[i++] = lower_expr(ec, arg, 0);
+    }
+
+    Ast *method = is_println(call) ? NULL : find_callee(ec, call);
+    CType ret = method ? ctype_from_str(ec, method->as.method_decl.ret_type) : CT_VOID;
+    Operand result = none;
+    if (ret == CT_VOID || discard) {
+        emit_indent(ec);
+    } else {
+        result = new_temp(ec, ret);
+    }
+    if (method) {
+        emit_name(ec, "j_", method->as.method_decl.name);
+    } else if (is_println(call)) {
+        fputs(println_fn(ec, call), ec->out);
+    } else {
+        emit_fail(ec, call, "call");
+    }
+    fputc('(', ec->out);
+    for (i = 0; i < argc; i++) {
+        emit_operand(ec, args[i]);
+        if (i + 1 < argc) fputs(", ", ec->out);
+    }
+    fputs(");\n", ec->out);
+    free(args);
+    return result;
+}
+
+static Operand lower_bin_op(EmitC *ec, Ast *node, Operand lhs, Operand rhs) {
+    Operand result = new_temp(ec, is_comparison(node->as.bin.op) ? CT_BOOL : CT_INT);
+    if (is_comparison(node->as.bin.op)) {
+        emit_operand(ec, lhs);
+        fprintf(ec->out, " %s ", compare_op(node->as.bin.op));
+        emit_operand(ec, rhs);
+    } else {
+        fprintf(ec->out, "%s(", arith_fn(node->as.bin.op));
+        emit_operand(ec, lhs);
+        fputs(", ", ec->out);
+        emit_operand(ec, rhs);
+        fputc(')', ec->out);
+    }
+    fputs(";\n", ec->out);
+    return result;
+}
+
+/* Evaluates the post-order slice left to right, one temporary per operator. */
+static Operand lower_bin(EmitC *ec, Ast *expr) {
+    if (!expr->as.bin.post) {
+        Operand lhs = lower_expr(ec, expr->as.bin.lhs, 0);
+        Operand rhs = lower_expr(ec, expr->as.bin.rhs, 0);
+        return lower_bin_op(ec, expr, lhs, rhs);
+    }
+    Operand none = {OP_VOID, 0, {NULL, 0}, NULL, 0};
+    size_t n = expr->as.bin.post_len;
+    Operand *stack = (Operand *)malloc(n * sizeof(Operand));
+    if (!stack) {
+        ec->failed = 1;
+        return none;
+    }
+    size_t depth = 0;
+    for (size_t i = 0; i < n; i++) {
+        Ast *node = expr->as.bin.post[i];
+        if (node->kind != AST_BIN) {
+            stack[depth++] = lower_expr(ec, node, 0);
+            continue;
+        }
+        Operand rhs = stack[--depth];
+        Operand lhs = stack[--depth];
+        stack[depth++] = lower_bin_op(ec, node, lhs, rhs);
+    }
+    Operand result = stack[0];
+    free(stack);
+    return result;
+}
+
+static Operand lower_expr(EmitC *ec, Ast *expr, int discard) {
+    Operand op = {OP_VOID, 0, {NULL, 0}, NULL, 0};
+    switch (expr->kind) {
+        case AST_INT_LIT:
+            op.kind = OP_INT;
+            op.value = expr->as.int_lit.value;
+            break;
+        case AST_IDENT:
+            op.kind = OP_LOCAL;
+            op.name = expr->as.ident.name;
+            break;
+        case AST_STRING_LIT:
+            op.kind = OP_STRING;
+            op.string = expr;
+            break;
+        case AST_BIN:
+            if (is_string_bin(expr)) {
+                op.kind = OP_STRING;
+                op.string = expr;
+                break;
+            }
+            return lower_bin(ec, expr);
+        case AST_CALL:
+            return lower_call(ec, expr, discard);
+        case AST_NEW:
+            op = new_temp(ec, CT_OBJECT);
+            emit_expr(ec, expr);
+            fputs(";\n", ec->out);
+            break;
+        default:
+            emit_fail(ec, expr, "expression");
+            break;
+    }
+    return op;
+}
+
+/*
+ * Writes the value of expr as an operand of the statement being emitted.
+ * Lowered expressions first emit their temporaries on lines of their own,
+ * so callers use this before starting the statement's line.
+ */
+typedef struct {
+    Ast *expr;
+    int lowered;
+    Operand op;
+} Value;
+
+static Value prepare_value(EmitC *ec, Ast *expr) {
+    Value v = {expr, 0, {OP_VOID, 0, {NULL, 0}, NULL, 0}};
+    if (expr && needs_lowering(expr)) {
+        v.lowered = 1;
+        v.op = lower_expr(ec, expr, 0);
+    }
+    return v;
+}
+
+static void emit_value(EmitC *ec, Value v) {
+    if (v.lowered) {
+        emit_operand(ec, v.op);
+    } else {
+        emit_expr(ec, v.expr);
+    }
+}
+
+/* Like emit_value, without the parentheses a bare comparison would get. */
+static void emit_cond(EmitC *ec, Value v) {
+    Ast *cond = v.expr;
+    if (v.lowered || cond->kind != AST_BIN || !is_comparison(cond->as.bin.op)) {
+        emit_value(ec, v);
+        return;
+    }
+    emit_expr(ec, cond->as.bin.lhs);
+    fprintf(ec->out, " %s ", compare_op(cond->as.bin.op));
+    emit_expr(ec, cond->as.bin.rhs);
+}
+
+static void emit_stmt(EmitC *ec, Ast *stmt);
+
+static void emit_block_body(EmitC *ec, Ast *stmt) {
+    int count = ec->local_count;
+    if (stmt && stmt->kind == AST_BLOCK) {
+        for (Ast *s = stmt->as.block.stmts; s; s = s->next) {
+            emit_stmt(ec, s);
+        }
+    } else {
+        emit_stmt(ec, stmt);
+    }
+    ec->local_count = count;
+}
+
+/* Emits `{ body }` at the current line position, for branches and loop bodies. */
+static void emit_braced(EmitC *ec, Ast *stmt) {
+    fputs("{\n", ec->out);
+    ec->indent++;
+    emit_block_body(ec, stmt);
+    ec->indent--;
+    emit_indent(ec);
+    fputc('}', ec->out);
+}
+
+static void emit_expr_stmt(EmitC *ec, Ast *expr) {
+    if (expr->kind == AST_CALL && needs_lowering(expr)) {
+        lower_call(ec, expr, 1);
+        return;
+    }
+    Value v = prepare_value(ec, expr);
+    emit_indent(ec);
+    if (expr->kind != AST_CALL) fputs("(void)", ec->out);
+    emit_value(ec, v);
+    fputs(";\n", ec->out);
+}
+
+static void emit_loop_exit(EmitC *ec, Ast *cond) {
+    if (!cond) return;
+    Value v = prepare_value(ec, cond);
+    emit_indent(ec);
+    fputs("if (!(", ec->out);
+    emit_cond(ec, v);
+    fputs(")) break;\n", ec->out);
+}
+
+static int reads_local(Ast *node, void *user) {
+    Str name = *(Str *)user;
+    return (node->kind == AST_IDENT && str_eq(node->as.ident.name, name)) ||
+           (node->kind == AST_INC && str_eq(node->as.inc.name, name));
+}
+
+/* Whether any statement in the chain starting at scope reads name. */
+static int local_is_read(Ast *scope, Str name) {
+    for (; scope; scope = scope->next) {
+        if (ast_visit(scope, reads_local, &name)) return 1;
+    }
+    return 0;
+}
+
+/* Java allows locals that are never read; C warns about them unless they are cast to void. */
+static void emit_var_decl(EmitC *ec, Ast *stmt, int read) {
+    if (!check_ctype(ec, stmt, stmt->as.var_decl.type)) return;
+    CType type = ctype_from_str(ec, stmt->as.var_decl.type);
+    Value v = prepare_value(ec, stmt->as.var_decl.init);
+    emit_indent(ec);
+    emit_decl(ec, type, "v_", stmt->as.var_decl.name);
+    fputs(" = ", ec->out);
+    if (stmt->as.var_decl.init) {
+        emit_value(ec, v);
+    } else {
+        fputs(type == CT_STRING ? "JRT_NULL" : type == CT_OBJECT ? "NULL" : "0", ec->out);
+    }
+    fputs(";\n", ec->out);
+    if (!read) {
+        emit_indent(ec);
+        fputs("(void)", ec->out);
+        emit_name(ec, "v_", stmt->as.var_decl.name);
+        fputs(";\n", ec->out);
+    }
+    locals_push(ec, stmt->as.var_decl.name, type);
+}
+
+static void emit_stmt(EmitC *ec, Ast *stmt) {
+    if (!stmt || ec->failed) return;
+    switch (stmt->kind) {
+        case AST_VAR_DECL:
+            emit_var_decl(ec, stmt, local_is_read(stmt->next, stmt->as.var_decl.name));
+            break;
+        case AST_ASSIGN: {
+            Value v = prepare_value(ec, stmt->as.assign.value);
+            emit_indent(ec);
+            emit_name(ec, "v_", stmt->as.assign.name);
+            fputs(" = ", ec->out);
+            emit_value(ec, v);
+            fputs(";\n", ec->out);
+        } break;
+        case AST_INC:
+            emit_indent(ec);
+            emit_name(ec, "v_", stmt->as.inc.name);
+            fputs(" = jrt_add(", ec->out);
+            emit_name(ec, "v_", stmt->as.inc.name);
+            fputs(", 1);\n", ec->out);
+            break;
+        case AST_EXPR_STMT:
+            emit_expr_stmt(ec, stmt->as.expr_stmt.expr);
+            break;
+        case AST_RETURN: {
+            Value v = prepare_value(ec, stmt->as.return_stmt.expr);
+            emit_indent(ec);
+            fputs("return", ec->out);
+            if (stmt->as.return_stmt.expr) {
+                fputc(' ', ec->out);
+                emit_value(ec, v);
+            }
+            fputs(";\n", ec->out);
+        } break;
+        case AST_BLOCK:
+            emit_indent(ec);
+            emit_braced(ec, stmt);
+            fputc('\n', ec->out);
+            break;
+        case AST_IF: {
+            Value v = prepare_value(ec, stmt->as.if_stmt.cond);
+            emit_indent(ec);
+            fputs("if (", ec->out);
+            emit_cond(ec, v);
+            fputs(") ", ec->out);
+            emit_braced(ec, stmt->as.if_stmt.then_branch);
+            if (stmt->as.if_stmt.else_branch) {
+                fputs(" else ", ec->out);
+                emit_braced(ec, stmt->as.if_stmt.else_branch);
+            }
+            fputc('\n', ec->out);
+        } break;
+        case AST_WHILE:
+            emit_indent(ec);
+            if (!needs_lowering(stmt->as.while_stmt.cond)) {
+                Value v = {stmt->as.while_stmt.cond, 0, {OP_VOID, 0, {NULL, 0}, NULL, 0}};
+                fputs("while (", ec->out);
+                emit_cond(ec, v);
+                fputs(") ", ec->out);
+                emit_braced(ec, stmt->as.while_stmt.body);
+                fputc('\n', ec->out);
+                break;
+            }
+            fputs("for (;;) {\n", ec->out);
+            ec->indent++;
+            emit_loop_exit(ec, stmt->as.while_stmt.cond);
+            emit_block_body(ec, stmt->as.while_stmt.body);
+            ec->indent--;
+            emit_indent(ec);
+            fputs("}\n", ec->out);
+            break;
+        case AST_FOR: {
+            /* No break/continue in the language, so the update can simply follow the body. */
+            int count = ec->local_count;
+            emit_indent(ec);
+            fputs("{\n", ec->out);
+            ec->indent++;
+            Ast *init = stmt->as.for_stmt.init;
+            if (init && init->kind == AST_VAR_DECL) {
+                Str name = init->as.var_decl.name;
+                emit_var_decl(ec, init,
+                              local_is_read(stmt->as.for_stmt.cond, name) ||
+                                  local_is_read(stmt->as.for_stmt.update, name) ||
+                                  local_is_read(stmt->as.for_stmt.body, name));
+            } else {
+                emit_stmt(ec, init);
+            }
+            emit_indent(ec);
+            fputs("for (;;) {\n", ec->out);
+            ec->indent++;
+            emit_loop_exit(ec, stmt->as.for_stmt.cond);
+            emit_indent(ec);
+            emit_braced(ec, stmt->as.for_stmt.body);
+            fputc('\n', ec->out);
+            emit_stmt(ec, stmt->as.for_stmt.update);
+            ec->indent--;
+            emit_indent(ec);
+            fputs("}\n", ec->out);
+            ec->indent--;
+            emit_indent(ec);
+            fputs("}\n", ec->out);
+            ec->local_count = count;
+        } break;
+        default:
+            emit_fail(ec, stmt, "statement");
+            break;
+    }
+}
+
+static void emit_signature(EmitC *ec, Ast *method) {
+    fputs("static ", ec->out);
+    emit_decl(ec, ctype_from_str(ec, method->as.method_decl.ret_type), "j_", method->as.method_decl.name);
+    fputc('(', ec->out);
+    Ast *param = method->as.method_decl.params;
+    if (!param) fputs("void", ec->out);
+    for (; param; param = param->next) {
+        emit_decl(ec, ctype_from_str(ec, param->as.var_decl.type), "v_", param->as.var_decl.name);
+        if (param->next) fputs(", ", ec->out);
+    }
+    fputc(')', ec->out);
+}
+
+static void emit_method(EmitC *ec, Ast *method) {
+    emit_signature(ec, method);
+    fputs(" {\n", ec->out);
+    ec->local_count = 0;
+    ec->temps = 0;
+    for (Ast *param = method->as.method_decl.params; param; param = param->next) {
+        locals_push(ec, param->as.var_decl.name, ctype_from_str(ec, param->as.var_decl.type));
+    }
+    ec->indent = 1;
+    if (str_eq_c(method->as.method_decl.name, "main") && method->as.method_decl.params) {
+        emit_indent(ec);
+        fputs("(void)", ec->out);
+        emit_name(ec, "v_", method->as.method_decl.params->as.var_decl.name);
+        fputs(";\n", ec->out);
+    }
+    if (method->as.method_decl.body) {
+        for (Ast *s = method->as.method_decl.body->as.block.stmts; s; s = s->next) {
+            emit_stmt(ec, s);
+        }
+    }
+    ec->indent = 0;
+    fputs("}\n\n", ec->out);
+}
+
+/* Fields can't be accessed yet, but they keep the object's size honest. */
+static void emit_struct(EmitC *ec) {
+    emit_struct_name(ec);
+    fputs(" {\n", ec->out);
+    int fields = 0;
+    for (Ast *member = ec->clazz->as.class_decl.members; member; member = member->next) {
+        if (member->kind != AST_FIELD) continue;
+        fputs("    ", ec->out);
+        emit_decl(ec, ctype_from_str(ec, member->as.field_decl.type), "f_", member->as.field_decl.name);
+        fputs(";\n", ec->out);
+        fields++;
+    }
+    if (!fields) {
+        fputs("    char unused;\n", ec->out);
+    }
+    fputs("};\n\n", ec->out);
+}
+
+/* Only static methods can be called in this subset, so instance methods are dropped. */
+static int emits_method(Ast *member) {
+    return member->kind == AST_METHOD && member->as.method_decl.is_static;
+}
+
+static int is_live(EmitC *ec, Ast *method) {
+    for (int i = 0; i < ec->live_count; i++) {
+        if (ec->live[i] == method) return 1;
+    }
+    return 0;
+}
+
+static void mark_live(EmitC *ec, Ast *method) {
+    if (!method || !emits_method(method) || is_live(ec, method)) return;
+    if (ec->live_count == ec->live_cap) {
+        int cap = ec->live_cap ? ec->live_cap * 2 : 32;
+        Ast **grown = (Ast **)realloc(ec->live, (size_t)cap * sizeof(Ast *));
+        if (!grown) {
+            ec->failed = 1;
+            return;
+        }
+        ec->live = grown;
+        ec->live_cap = cap;
+    }
+    ec->live[ec->live_count++] = method;
+}
+
+static int mark_callee(Ast *node, void *user) {
+    EmitC *ec = (EmitC *)user;
+    if (node->kind == AST_CALL && !is_println(node)) {
+        mark_live(ec, find_callee(ec, node));
+    }
+    return 0;
+}
+
+/*
+ * Only methods main can reach are emitted: C warns about a static function
+ * nothing calls, such as one whose every call site was inlined.
+ */
+static void mark_reachable(EmitC *ec, Ast *main_method) {
+    mark_live(ec, main_method);
+    for (int i = 0; i < ec->live_count; i++) {
+        ast_visit(ec->live[i], mark_callee, ec);
+    }
+}
+
+int emit_c_comp_unit(Ast *comp_unit, const char *source_path, FILE *out, Diag *diag) {
+    if (!comp_unit || !comp_unit->as.comp_unit.clazz) {
+        return 0;
+    }
+    EmitC ec;
+    memset(&ec, 0, sizeof(ec));
+    ec.out = out;
+    ec.diag = diag;
+    ec.clazz = comp_unit->as.comp_unit.clazz;
+    if (ec.clazz->next) {
+        diag_error(diag, ec.clazz->next->tok.pos, "C backend: only one class per file is supported");
+        return 0;
+    }
+
+    fprintf(out, "/* Generated by the TinyJvm C backend from %s. */\n", source_path ? source_path : "<input>");
+    fputs(prelude, out);
+    fputc('\n', out);
+    emit_struct(&ec);
+
+    Ast *members = ec.clazz->as.class_decl.members;
+    Ast *main_method = NULL;
+    for (Ast *member = members; member; member = member->next) {
+        if (!emits_method(member)) continue;
+        check_ctype(&ec, member, member->as.method_decl.ret_type);
+        for (Ast *param = member->as.method_decl.params; param; param = param->next) {
+            check_ctype(&ec, param, param->as.var_decl.type);
+        }
+        if (str_eq_c(member->as.method_decl.name, "main")) {
+            main_method = member;
+        }
+    }
+    mark_reachable(&ec, main_method);
+    for (Ast *member = members; member; member = member->next) {
+        if (is_live(&ec, member)) {
+            emit_signature(&ec, member);
+            fputs(";\n", out);
+        }
+    }
+    fputc('\n', out);
+    for (Ast *member = members; member && !ec.failed; member = member->next) {
+        if (is_live(&ec, member)) {
+            emit_method(&ec, member);
+        }
+    }
+    if (!main_method) {
+        diag_error(diag, comp_unit->tok.pos, "C backend: main method not found");
+        ec.failed = 1;
+    } else {
+        fputs("int main(int argc, char **argv) {\n", out);
+        fputs("    jrt_string_array args = {argc - 1, argv + 1};\n", out);
+        fputs("    j_main(args);\n", out);
+        fputs("    return 0;\n", out);
+        fputs("}\n", out);
+    }
+    free(ec.locals);
+    free(ec.live);
+    return !ec.failed && !ferror(out);
+}
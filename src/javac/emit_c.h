@@ -0,0 +1,19 @@
+#ifndef TINYJVM_EMIT_C_H
+#define TINYJVM_EMIT_C_H
+
+#include <stdio.h>
+#include "../common/ast.h"
+#include "../common/diag.h"
+
+/*
+ * The C backend: translates a checked compilation unit into one self-contained
+ * C11 file, runtime included, that builds with the same toolchain as the
+ * VM (musl-gcc -O2 -static). Static methods become C functions and main
+ * becomes the program entry point. int arithmetic wraps and division throws
+ * the way the VM does. Expressions that have more than one side effect are
+ * lowered into temporaries in post-order, which keeps Java's left-to-right
+ * evaluation order and avoids recursing on deep expressions.
+ */
+int emit_c_comp_unit(Ast *comp_unit, const char *source_path, FILE *out, Diag *diag);
+
+#endif
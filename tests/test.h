@@ -0,0 +1,164 @@
+#ifndef TINYJVM_TEST_H
+#define TINYJVM_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/common/arena.h"
+#include "../src/common/diag.h"
+#include "../src/common/parser.h"
+#include "../src/common/type_check.h"
+
+/* Each test binary counts failed checks and exits non-zero if there were any. */
+static int test_failures;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                     \
+        }                                                                        \
+    } while (0)
+
+static inline int test_report(const char *name) {
+    if (test_failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+/* The diagnostics buffered on diag as a NUL-terminated string in buf, cut to fit cap. */
+static inline const char *test_diag_messages(const Diag *diag, char *buf, size_t cap) {
+    size_t n = diag->buf_len < cap - 1 ? diag->buf_len : cap - 1;
+    if (n) {
+        memcpy(buf, diag->buf, n);
+    }
+    buf[n] = '\0';
+    return buf;
+}
+
+/* A parsed and checked source whose diagnostics are collected instead of printed. */
+typedef struct {
+    Diag parent;
+    Diag diag;
+    Arena arena;
+    Ast *unit;
+    char *messages;
+} TestUnit;
+
+static inline int test_compile(TestUnit *t, const char *src) {
+    size_t len = strlen(src);
+    diag_init(&t->parent, "Test.java", src, len);
+    diag_init_buffered(&t->diag, &t->parent);
+    arena_init(&t->arena);
+    t->messages = NULL;
+    Parser ps;
+    parser_init(&ps, src, len, &t->diag, &t->arena);
+    t->unit = parse_compilation_unit(&ps);
+    parser_free(&ps);
+    if (t->unit && !t->diag.had_error) {
+        type_check_comp_unit(t->unit, &t->diag);
+    }
+    return !t->diag.had_error;
+}
+
+/* The diagnostics as one NUL-terminated string. */
+static inline const char *test_messages(TestUnit *t) {
+    free(t->messages);
+    t->messages = (char *)malloc(t->diag.buf_len + 1);
+    if (!t->messages) {
+        return "";
+    }
+    return test_diag_messages(&t->diag, t->messages, t->diag.buf_len + 1);
+}
+
+static inline void test_unit_free(TestUnit *t) {
+    free(t->messages);
+    diag_free(&t->diag);
+    diag_free(&t->parent);
+    arena_free(&t->arena);
+}
+
+/* Finds a method by name in the unit's first class. */
+static inline Ast *test_method(Ast *unit, const char *name) {
+    for (Ast *m = unit->as.comp_unit.clazz->as.class_decl.members; m; m = m->next) {
+        if (m->kind == AST_METHOD && str_eq_c(m->as.method_decl.name, name)) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static inline void test_trace_append(char *buf, size_t cap, Str word) {
+    size_t len = strlen(buf);
+    if (len + word.len + 2 < cap) {
+        memcpy(buf + len, word.data, word.len);
+        buf[len + word.len] = ' ';
+        buf[len + word.len + 1] = '\0';
+    }
+}
+
+static inline void test_trace(const Ast *node, char *buf, size_t cap);
+
+static inline void test_trace_list(const Ast *node, char *buf, size_t cap) {
+    for (; node; node = node->next) {
+        test_trace(node, buf, cap);
+    }
+}
+
+/*
+ * Appends the calls and divisions under node in Java evaluation order
+ * (operands left to right, then the operator; arguments, then the call),
+ * e.g. "p / println ". Branches and loop bodies appear once, in source order.
+ */
+static inline void test_trace(const Ast *node, char *buf, size_t cap) {
+    static const Str div = {"/", 1};
+    static const Str rem = {"%", 1};
+    if (!node) {
+        return;
+    }
+    switch (node->kind) {
+        case AST_METHOD: test_trace(node->as.method_decl.body, buf, cap); break;
+        case AST_BLOCK: test_trace_list(node->as.block.stmts, buf, cap); break;
+        case AST_RETURN: test_trace(node->as.return_stmt.expr, buf, cap); break;
+        case AST_VAR_DECL: test_trace(node->as.var_decl.init, buf, cap); break;
+        case AST_EXPR_STMT: test_trace(node->as.expr_stmt.expr, buf, cap); break;
+        case AST_ASSIGN: test_trace(node->as.assign.value, buf, cap); break;
+        case AST_IF:
+            test_trace(node->as.if_stmt.cond, buf, cap);
+            test_trace(node->as.if_stmt.then_branch, buf, cap);
+            test_trace(node->as.if_stmt.else_branch, buf, cap);
+            break;
+        case AST_WHILE:
+            test_trace(node->as.while_stmt.cond, buf, cap);
+            test_trace(node->as.while_stmt.body, buf, cap);
+            break;
+        case AST_FOR:
+            test_trace(node->as.for_stmt.init, buf, cap);
+            test_trace(node->as.for_stmt.cond, buf, cap);
+            test_trace(node->as.for_stmt.body, buf, cap);
+            test_trace(node->as.for_stmt.update, buf, cap);
+            break;
+        case AST_BIN:
+            test_trace(node->as.bin.lhs, buf, cap);
+            test_trace(node->as.bin.rhs, buf, cap);
+            if (node->as.bin.op == TOK_SLASH) test_trace_append(buf, cap, div);
+            if (node->as.bin.op == TOK_PERCENT) test_trace_append(buf, cap, rem);
+            break;
+        case AST_CALL: {
+            test_trace_list(node->as.call.args, buf, cap);
+            Str name = node->as.call.callee;
+            size_t dot = name.len;
+            while (dot > 0 && name.data[dot - 1] != '.') dot--;
+            Str last = {name.data + dot, name.len - dot};
+            test_trace_append(buf, cap, last);
+            break;
+        }
+        default: break;
+    }
+}
+
+#endif
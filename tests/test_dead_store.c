@@ -0,0 +1,97 @@
+#include "test.h"
+#include "../src/common/dead_store.h"
+
+static const char *program =
+    "public class Dse {\n"
+    "    static int p(int x) {\n"
+    "        System.out.println(x);\n"
+    "        return x;\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        int a = 1;\n"
+    "        a = 2;\n"
+    "        System.out.println(a);\n"
+    "        int b = p(3);\n"
+    "        int unused;\n"
+    "        int s = 0;\n"
+    "        for (int i = 0; i < 10; i++) {\n"
+    "            s = s + i;\n"
+    "        }\n"
+    "        System.out.println(s);\n"
+    "        int x = 0;\n"
+    "        int k = 0;\n"
+    "        while (k < 5) {\n"
+    "            System.out.println(x);\n"
+    "            x = k * 2;\n"
+    "            k++;\n"
+    "        }\n"
+    "        int last = 7;\n"
+    "        last = 8;\n"
+    "    }\n"
+    "}\n";
+
+typedef struct {
+    const char *name;
+    int decls;
+    int inits;
+    int stores;
+} Uses;
+
+static int count_uses(Ast *node, void *user) {
+    Uses *u = (Uses *)user;
+    if (node->kind == AST_VAR_DECL && str_eq_c(node->as.var_decl.name, u->name)) {
+        u->decls++;
+        u->inits += node->as.var_decl.init != NULL;
+    } else if (node->kind == AST_ASSIGN && str_eq_c(node->as.assign.name, u->name)) {
+        u->stores++;
+    }
+    return 0;
+}
+
+static Uses uses_of(Ast *method, const char *name) {
+    Uses u = {name, 0, 0, 0};
+    ast_visit(method, count_uses, &u);
+    return u;
+}
+
+int main(void) {
+    TestUnit t;
+    CHECK(test_compile(&t, program));
+
+    DeadStoreStats stats = {0, 0, 0};
+    CHECK(dead_store_eliminate(t.unit, &t.arena, &stats));
+    CHECK(type_check_comp_unit(t.unit, &t.diag));
+    Ast *main_method = test_method(t.unit, "main");
+
+    /* a = 1 is overwritten before any read; a = 2 is printed. */
+    Uses a = uses_of(main_method, "a");
+    CHECK(a.decls == 1 && a.inits == 0 && a.stores == 1);
+
+    /* b is never read, but p(3) prints, so the call stays as a statement. */
+    Uses b = uses_of(main_method, "b");
+    CHECK(b.decls == 0 && b.stores == 0);
+    char trace[256] = "";
+    test_trace(main_method, trace, sizeof(trace));
+    CHECK(strncmp(trace, "println p ", 10) == 0);
+
+    CHECK(uses_of(main_method, "unused").decls == 0);
+
+    /* Stores read by the next iteration are live. */
+    Uses s = uses_of(main_method, "s");
+    CHECK(s.decls == 1 && s.inits == 1 && s.stores == 1);
+    Uses x = uses_of(main_method, "x");
+    CHECK(x.decls == 1 && x.inits == 1 && x.stores == 1);
+
+    /* Nothing reads last. */
+    CHECK(uses_of(main_method, "last").decls == 0);
+    CHECK(uses_of(main_method, "last").stores == 0);
+
+    CHECK(stats.stores_removed >= 3);
+    CHECK(stats.locals_removed >= 3);
+    if (test_failures) {
+        fprintf(stderr, "trace: %s\n", trace);
+    }
+
+    test_unit_free(&t);
+    return test_report("test_dead_store");
+}
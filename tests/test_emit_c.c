@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/common/dead_store.h"
+#include "../src/common/escape.h"
+#include "../src/common/inline.h"
+#include "../src/javac/emit_c.h"
+
+/* The compiler the generated C is built with; the Makefile passes $(CC). */
+#ifndef TEST_CC
+#define TEST_CC "cc"
+#endif
+
+static const char program[] =
+    "public class Emit {\n"
+    "    static int sq(int x) {\n"
+    "        return x * x;\n"
+    "    }\n"
+    "    static int p(int x) {\n"
+    "        System.out.println(x);\n"
+    "        return x;\n"
+    "    }\n"
+    "    static String greet() {\n"
+    "        return \"a\\0b\";\n"
+    "    }\n"
+    "    static int sign(int x) {\n"
+    "        if (x < 0) {\n"
+    "            return 0 - 1;\n"
+    "        } else {\n"
+    "            return 1;\n"
+    "        }\n"
+    "    }\n"
+    "    static int climb(int x) {\n"
+    "        while (1 == 1) {\n"
+    "            if (x > 10) {\n"
+    "                return x;\n"
+    "            }\n"
+    "            x = x + 3;\n"
+    "        }\n"
+    "    }\n"
+    "    static int never(int x) {\n"
+    "        int unread = x;\n"
+    "        return 7;\n"
+    "    }\n"
+    "    static Emit make() {\n"
+    "        Emit e = new Emit();\n"
+    "        return e;\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        String s = greet();\n"
+    "        System.out.println(s);\n"
+    "        System.out.println(\"n=\" + 2147483647 + 1);\n"
+    "        int big = 2147483647;\n"
+    "        System.out.println(big + 1);\n"
+    "        int dead = 5;\n"
+    "        dead = 6;\n"
+    "        int t = sq(p(3)) + sq(4);\n"
+    "        System.out.println(t);\n"
+    "        System.out.println(sign(0 - 4) + sign(4));\n"
+    "        System.out.println(climb(1));\n"
+    "        int sum = 0;\n"
+    "        for (int i = 0; i < 5; i++) {\n"
+    "            sum = sum + i * i;\n"
+    "        }\n"
+    "        System.out.println(sum);\n"
+    "        System.out.println((0 - 7) / 2);\n"
+    "        System.out.println((0 - 7) % 3);\n"
+    "        Emit e = make();\n"
+    "        int z = 0;\n"
+    "        System.out.println(p(1) + 1 / z);\n"
+    "        System.out.println(\"unreachable\");\n"
+    "    }\n"
+    "}\n";
+
+/* What java prints for program; it exits through the ArithmeticException. */
+static const char expected_out[] = "a\0b\nn=21474836471\n-2147483648\n3\n25\n0\n13\n30\n-3\n-1\n1\n";
+static const char expected_err[] = "Exception in thread \"main\" java.lang.ArithmeticException: / by zero\n";
+
+typedef struct {
+    char dir[32];
+    char path[64];
+    char *out;
+    size_t out_len;
+    char *err;
+    size_t err_len;
+    int status;
+} Run;
+
+static char *slurp(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    char *buf = NULL;
+    size_t cap = 0;
+    *len = 0;
+    for (;;) {
+        if (*len == cap) {
+            cap = cap ? cap * 2 : 256;
+            char *grown = (char *)realloc(buf, cap);
+            if (!grown) break;
+            buf = grown;
+        }
+        size_t n = fread(buf + *len, 1, cap - *len, f);
+        if (n == 0) break;
+        *len += n;
+    }
+    fclose(f);
+    return buf;
+}
+
+static void run_path(Run *r, const char *name) {
+    snprintf(r->path, sizeof(r->path), "%s/%s", r->dir, name);
+}
+
+/* Emits unit as C, builds it and runs it; returns 0 if any step before running failed. */
+static int emit_and_run(Ast *unit, Diag *diag, Run *r) {
+    char cmd[256];
+    memset(r, 0, sizeof(*r));
+    strcpy(r->dir, "/tmp/tinyjvm-emit-XXXXXX");
+    if (!mkdtemp(r->dir)) return 0;
+
+    run_path(r, "prog.c");
+    FILE *f = fopen(r->path, "w");
+    if (!f) return 0;
+    int ok = emit_c_comp_unit(unit, "Emit.java", f, diag);
+    fclose(f);
+    if (!ok) return 0;
+
+    /* program has an uncalled method and unread locals, and inlining leaves more; none may warn. */
+    snprintf(cmd, sizeof(cmd), TEST_CC " -std=c11 -O2 -Wall -Werror -o %s/prog %s/prog.c", r->dir, r->dir);
+    if (system(cmd) != 0) return 0;
+    snprintf(cmd, sizeof(cmd), "%s/prog >%s/out 2>%s/err", r->dir, r->dir, r->dir);
+    int status = system(cmd);
+    r->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    run_path(r, "out");
+    r->out = slurp(r->path, &r->out_len);
+    run_path(r, "err");
+    r->err = slurp(r->path, &r->err_len);
+    return r->out && r->err;
+}
+
+static void run_free(Run *r) {
+    static const char *const files[] = {"prog.c", "prog", "out", "err"};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        run_path(r, files[i]);
+        unlink(r->path);
+    }
+    rmdir(r->dir);
+    free(r->out);
+    free(r->err);
+}
+
+static void check_run(Run *r) {
+    CHECK(r->status == 1);
+    CHECK(r->out_len == sizeof(expected_out) - 1 && memcmp(r->out, expected_out, r->out_len) == 0);
+    CHECK(r->err_len == sizeof(expected_err) - 1 && memcmp(r->err, expected_err, r->err_len) == 0);
+    if (test_failures && r->out) {
+        fprintf(stderr, "stdout:\n");
+        fwrite(r->out, 1, r->out_len, stderr);
+    }
+}
+
+static void test_program(void) {
+    /* Built as written. */
+    TestUnit t;
+    CHECK(test_compile(&t, program));
+    Run plain;
+    CHECK(emit_and_run(t.unit, &t.diag, &plain));
+    check_run(&plain);
+    run_free(&plain);
+    test_unit_free(&t);
+
+    /* The same program after the AST passes must behave the same. */
+    CHECK(test_compile(&t, program));
+    InlineStats inl = {0, 0};
+    DeadStoreStats dse;
+    memset(&dse, 0, sizeof(dse));
+    CHECK(inline_static_calls(t.unit, &t.arena, NULL, &inl));
+    EscapeStats esc;
+    CHECK(escape_eliminate(t.unit, &t.arena, &esc));
+    CHECK(dead_store_eliminate(t.unit, &t.arena, &dse));
+    CHECK(inl.calls_inlined > 0);
+    CHECK(esc.locals_removed > 0);
+    CHECK(type_check_comp_unit(t.unit, &t.diag));
+    Run opt;
+    CHECK(emit_and_run(t.unit, &t.diag, &opt));
+    check_run(&opt);
+    run_free(&opt);
+    test_unit_free(&t);
+}
+
+static int rejects(const char *body, const char *message) {
+    char src[512];
+    snprintf(src, sizeof(src),
+             "public class R {\n"
+             "    static int f(int x) {\n"
+             "%s"
+             "    }\n"
+             "    public static void main(String[] args) {\n"
+             "        System.out.println(f(1));\n"
+             "    }\n"
+             "}\n",
+             body);
+    TestUnit t;
+    int ok = test_compile(&t, src);
+    int found = strstr(test_messages(&t), message) != NULL;
+    test_unit_free(&t);
+    return !ok && found;
+}
+
+static int accepts(const char *body) {
+    char src[512];
+    snprintf(src, sizeof(src),
+             "public class A {\n"
+             "    static int f(int x) {\n"
+             "%s"
+             "    }\n"
+             "    public static void main(String[] args) {\n"
+             "        System.out.println(f(1));\n"
+             "    }\n"
+             "}\n",
+             body);
+    TestUnit t;
+    int ok = test_compile(&t, src);
+    test_unit_free(&t);
+    return ok;
+}
+
+/* A non-void method that can complete normally would fall off the end of the C function. */
+static void test_missing_return(void) {
+    CHECK(rejects("        if (x < 1) {\n            return 1;\n        }\n", "missing return statement"));
+    CHECK(rejects("        x = x + 1;\n", "missing return statement"));
+    CHECK(rejects("        while (x < 3) {\n            return x;\n        }\n", "missing return statement"));
+    CHECK(rejects("        while (1 / 0 == 0) {\n            return x;\n        }\n", "missing return statement"));
+    CHECK(rejects("        if (x < 1) {\n            return 1;\n        } else {\n            x = 2;\n        }\n",
+                  "missing return statement"));
+
+    CHECK(accepts("        if (x < 1) {\n            return 1;\n        } else {\n            return 2;\n        }\n"));
+    CHECK(accepts("        while (2 * 3 > 5) {\n            x = x + 1;\n        }\n"));
+    CHECK(accepts("        for (;;) {\n            x = x + 1;\n        }\n"));
+    CHECK(accepts("        {\n            return x;\n        }\n"));
+}
+
+int main(void) {
+    test_program();
+    test_missing_return();
+    return test_report("test_emit_c");
+}
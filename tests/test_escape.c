@@ -0,0 +1,124 @@
+#include "test.h"
+#include "../src/common/escape.h"
+
+static const char *program =
+    "public class Esc {\n"
+    "    static int use(Esc e) {\n"
+    "        return 1;\n"
+    "    }\n"
+    "    static Esc make() {\n"
+    "        Esc e = new Esc();\n"
+    "        return e;\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        Esc a = new Esc();\n"
+    "        Esc b = new Esc();\n"
+    "        Esc c = b;\n"
+    "        Esc d = new Esc();\n"
+    "        Esc e = d;\n"
+    "        int n = use(e);\n"
+    "        Esc f = make();\n"
+    "        for (int i = 0; i < 3; i++) {\n"
+    "            Esc g = new Esc();\n"
+    "        }\n"
+    "        System.out.println(n);\n"
+    "    }\n"
+    "}\n";
+
+typedef struct {
+    int news;
+    int decls;
+    int calls;
+} Shape;
+
+static int count_shape(Ast *node, void *user) {
+    Shape *s = (Shape *)user;
+    s->news += node->kind == AST_NEW;
+    s->calls += node->kind == AST_CALL;
+    s->decls += node->kind == AST_VAR_DECL;
+    return 0;
+}
+
+static Shape shape_of(Ast *method) {
+    Shape s = {0, 0, 0};
+    ast_visit(method, count_shape, &s);
+    return s;
+}
+
+static int has_local(Ast *method, const char *name) {
+    for (Ast *s = method->as.method_decl.body->as.block.stmts; s; s = s->next) {
+        if (s->kind == AST_VAR_DECL && str_eq_c(s->as.var_decl.name, name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int rejects(const char *stmt, const char *message) {
+    char src[512];
+    snprintf(src, sizeof(src),
+             "public class Esc {\n"
+             "    public static void main(String[] args) {\n"
+             "        %s\n"
+             "    }\n"
+             "}\n",
+             stmt);
+    TestUnit t;
+    int ok = test_compile(&t, src);
+    int found = strstr(test_messages(&t), message) != NULL;
+    test_unit_free(&t);
+    return !ok && found;
+}
+
+/* The checker takes the enclosing class as a type and `new` of it, and nothing else. */
+static void test_checker(void) {
+    TestUnit t;
+    CHECK(test_compile(&t, program));
+    test_unit_free(&t);
+
+    CHECK(rejects("int x = new Esc();", "type mismatch"));
+    CHECK(rejects("Esc x = 1;", "type mismatch"));
+    CHECK(rejects("Esc x = new Other();", "unknown class 'Other'"));
+    CHECK(rejects("Esc x = new Esc(); System.out.println(x);", "println"));
+    CHECK(rejects("Esc x = new Esc(); int y = x + 1;", "unsupported '+' operands"));
+}
+
+static void test_elimination(void) {
+    TestUnit t;
+    CHECK(test_compile(&t, program));
+    EscapeStats stats;
+    CHECK(escape_eliminate(t.unit, &t.arena, &stats));
+
+    /* a, b, d and g in main, e in make. */
+    CHECK(stats.sites == 5);
+    /* a and b never leave main and g dies each iteration; d reaches use() through e. */
+    CHECK(stats.sites_eliminated == 3);
+    /* a, b, c, f and g; f's call to make() stays as a statement. */
+    CHECK(stats.locals_removed == 5);
+
+    Ast *main_method = test_method(t.unit, "main");
+    Shape s = shape_of(main_method);
+    CHECK(s.news == 1);
+    CHECK(s.calls == 3);
+    CHECK(!has_local(main_method, "a"));
+    CHECK(!has_local(main_method, "c"));
+    CHECK(!has_local(main_method, "f"));
+    CHECK(has_local(main_method, "d"));
+    CHECK(has_local(main_method, "e"));
+
+    /* make returns its object, so its allocation is kept. */
+    CHECK(shape_of(test_method(t.unit, "make")).news == 1);
+
+    /* What is left still checks, and output and calls keep their order. */
+    CHECK(type_check_comp_unit(t.unit, &t.diag));
+    char trace[128] = "";
+    test_trace(main_method, trace, sizeof(trace));
+    CHECK(strcmp(trace, "use make println ") == 0);
+    test_unit_free(&t);
+}
+
+int main(void) {
+    test_checker();
+    test_elimination();
+    return test_report("test_escape");
+}
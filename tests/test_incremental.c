@@ -0,0 +1,189 @@
+#include "test.h"
+#include "../src/common/incremental.h"
+
+static const char *other_src =
+    "class Other {\n"
+    "    static int g(int x) {\n"
+    "        return x * 2;\n"
+    "    }\n"
+    "}\n";
+
+/* A watched file with no main that only works against the project. */
+static const char *util_v1 =
+    "class Util {\n"
+    "    static int f(int x) {\n"
+    "        return Other.g(x);\n"
+    "    }\n"
+    "    static int h() {\n"
+    "        return 1;\n"
+    "    }\n"
+    "    static Other make() {\n"
+    "        Other o = new Other();\n"
+    "        return o;\n"
+    "    }\n"
+    "}\n";
+
+/* h's body changed. */
+static const char *util_v2 =
+    "class Util {\n"
+    "    static int f(int x) {\n"
+    "        return Other.g(x);\n"
+    "    }\n"
+    "    static int h() {\n"
+    "        return 2;\n"
+    "    }\n"
+    "    static Other make() {\n"
+    "        Other o = new Other();\n"
+    "        return o;\n"
+    "    }\n"
+    "}\n";
+
+/* Calls a method Other doesn't have. */
+static const char *util_bad =
+    "class Util {\n"
+    "    static int f(int x) {\n"
+    "        return Other.missing(x);\n"
+    "    }\n"
+    "    static int h() {\n"
+    "        return 2;\n"
+    "    }\n"
+    "    static Other make() {\n"
+    "        Other o = new Other();\n"
+    "        return o;\n"
+    "    }\n"
+    "}\n";
+
+/* f is gone, though the project index still has it from the first scan. */
+static const char *util_removed =
+    "class Util {\n"
+    "    static int h() {\n"
+    "        return Util.f(2);\n"
+    "    }\n"
+    "}\n";
+
+typedef struct {
+    int emitted;
+    int freed;
+    int classes;
+    size_t last_count;
+} Counts;
+
+static void emit_member(Ast *clazz, Ast *member, void **artifact, void *user) {
+    (void)clazz;
+    Counts *c = (Counts *)user;
+    if (*artifact) {
+        free(*artifact);
+        c->freed++;
+    }
+    *artifact = malloc(sizeof(Ast *));
+    if (*artifact) {
+        *(Ast **)*artifact = member;
+    }
+    c->emitted++;
+}
+
+static void free_artifact(void *artifact, void *user) {
+    ((Counts *)user)->freed++;
+    free(artifact);
+}
+
+static void end_class(Ast *clazz, void *const *artifacts, size_t count, void *user) {
+    Counts *c = (Counts *)user;
+    c->classes++;
+    c->last_count = count;
+    /* Artifacts come in member order, one per member. */
+    Ast *member = clazz->as.class_decl.members;
+    for (size_t i = 0; i < count; i++, member = member->next) {
+        CHECK(member && artifacts[i] && *(Ast *const *)artifacts[i] == member);
+    }
+    CHECK(member == NULL);
+}
+
+typedef struct {
+    Diag diag;
+    int ok;
+    char messages[512];
+} Update;
+
+static void update(Incremental *inc, const SymbolIndex *project, const char *src, Update *u) {
+    Diag parent;
+    diag_init(&parent, "Util.java", src, strlen(src));
+    diag_init_buffered(&u->diag, &parent);
+    u->ok = incremental_update(inc, "Util.java", src, strlen(src), project, &u->diag);
+    test_diag_messages(&u->diag, u->messages, sizeof(u->messages));
+    diag_free(&u->diag);
+    diag_free(&parent);
+}
+
+int main(void) {
+    /* The driver's declarations pass over the project, the watched file included. */
+    Diag pdiag;
+    diag_init(&pdiag, "project", NULL, 0);
+    Arena parena;
+    arena_init(&parena);
+    SymbolIndex project;
+    symbols_init(&project);
+    CHECK(symbols_scan_file(&project, "Other.java", other_src, strlen(other_src), &parena, &pdiag));
+    CHECK(symbols_scan_file(&project, "Util.java", util_v1, strlen(util_v1), &parena, &pdiag));
+
+    Counts counts = {0, 0, 0, 0};
+    IncrementalHooks hooks = {emit_member, free_artifact, end_class, &counts};
+    Incremental inc;
+    incremental_init(&inc, &hooks);
+    Update u;
+
+    /* Cold: cross-file calls and types check, and there is no main to require. */
+    update(&inc, &project, util_v1, &u);
+    CHECK(u.ok);
+    CHECK(strcmp(u.messages, "") == 0);
+    CHECK(inc.stats.members == 3 && inc.stats.reparsed == 3 && inc.stats.reused == 0);
+    CHECK(counts.emitted == 3 && counts.classes == 1 && counts.last_count == 3);
+
+    /* Same text: nothing to do. */
+    update(&inc, &project, util_v1, &u);
+    CHECK(u.ok);
+    CHECK(inc.stats.reused == 3 && inc.stats.reparsed == 0 && inc.stats.classes_emitted == 0);
+    CHECK(counts.emitted == 3 && counts.classes == 1);
+
+    /* One body edited: one member reparsed and emitted, the class emitted again. */
+    update(&inc, &project, util_v2, &u);
+    CHECK(u.ok);
+    CHECK(inc.stats.reused == 2 && inc.stats.reparsed == 1 && inc.stats.classes_emitted == 1);
+    CHECK(counts.emitted == 4 && counts.classes == 2 && counts.freed == 1);
+
+    /* An error reports and leaves the last clean state. */
+    update(&inc, &project, util_bad, &u);
+    CHECK(!u.ok);
+    CHECK(strstr(u.messages, "unknown method 'Other.missing'") != NULL);
+    CHECK(counts.emitted == 4 && counts.classes == 2);
+    update(&inc, &project, util_v2, &u);
+    CHECK(u.ok);
+    CHECK(inc.stats.reused == 3 && inc.stats.reparsed == 0 && inc.stats.classes_emitted == 0);
+
+    /* The file's own declarations hide the project's stale ones. */
+    update(&inc, &project, util_removed, &u);
+    CHECK(!u.ok);
+    CHECK(strstr(u.messages, "unknown method 'Util.f'") != NULL);
+
+    /* After invalidation, unchanged members are checked again. */
+    incremental_invalidate(&inc);
+    update(&inc, &project, util_v2, &u);
+    CHECK(u.ok);
+    CHECK(inc.stats.reused == 0 && inc.stats.reparsed == 3);
+
+    /* Without the project, Other can't be found. */
+    incremental_invalidate(&inc);
+    update(&inc, NULL, util_v2, &u);
+    CHECK(!u.ok);
+    CHECK(strstr(u.messages, "unknown method 'Other.g'") != NULL);
+    CHECK(strstr(u.messages, "main method not found") == NULL);
+
+    int emitted = counts.emitted;
+    incremental_free(&inc);
+    /* Every artifact that was made is freed exactly once. */
+    CHECK(counts.freed == emitted);
+    symbols_free(&project);
+    arena_free(&parena);
+    diag_free(&pdiag);
+    return test_report("test_incremental");
+}
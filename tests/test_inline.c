@@ -0,0 +1,83 @@
+#include "test.h"
+#include "../src/common/inline.h"
+
+static const char *program =
+    "public class Inl {\n"
+    "    static int twice(int x) {\n"
+    "        return x + x;\n"
+    "    }\n"
+    "    static int p(int x) {\n"
+    "        System.out.println(x);\n"
+    "        return x;\n"
+    "    }\n"
+    "    static int add(int a, int b) {\n"
+    "        return b + a;\n"
+    "    }\n"
+    "    static void show(int v) {\n"
+    "        System.out.println(v);\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        int z = 0;\n"
+    "        int r = twice(3);\n"
+    "        int s = twice(p(4));\n"
+    "        show(r + s);\n"
+    "        int t = add(p(1), 1 / z);\n"
+    "        System.out.println(t);\n"
+    "    }\n"
+    "}\n";
+
+static int count_words(const char *trace, const char *word) {
+    int n = 0;
+    size_t len = strlen(word);
+    for (const char *p = trace; (p = strstr(p, word)) != NULL; p += len) {
+        if ((p == trace || p[-1] == ' ') && p[len] == ' ') {
+            n++;
+        }
+    }
+    return n;
+}
+
+static int word_at(const char *trace, const char *word, int nth) {
+    size_t len = strlen(word);
+    int seen = 0;
+    for (const char *p = trace; (p = strstr(p, word)) != NULL; p += len) {
+        if ((p == trace || p[-1] == ' ') && p[len] == ' ' && seen++ == nth) {
+            return (int)(p - trace);
+        }
+    }
+    return -1;
+}
+
+int main(void) {
+    TestUnit t;
+    CHECK(test_compile(&t, program));
+
+    InlineStats stats = {0, 0};
+    CHECK(inline_static_calls(t.unit, &t.arena, NULL, &stats));
+    CHECK(stats.calls_inlined >= 2);
+    /* Inlined code must still check. */
+    CHECK(type_check_comp_unit(t.unit, &t.diag));
+
+    char trace[512] = "";
+    test_trace(test_method(t.unit, "main"), trace, sizeof(trace));
+
+    /* twice(3) and the void helper are substituted. */
+    CHECK(count_words(trace, "show") == 0);
+    /* p(4) has a side effect and x is used twice, so it runs exactly once. */
+    CHECK(count_words(trace, "p") == 2);
+    /* ...so twice(p(4)) is refused, while twice(3) is not. */
+    CHECK(count_words(trace, "twice") == 1);
+    /* add's body reads b first, but p(1) must still run before 1 / z can throw. */
+    int first_p = word_at(trace, "p", 1);
+    int div = word_at(trace, "/", 0);
+    CHECK(first_p >= 0 && div >= 0 && first_p < div);
+    /* Output order: p(4), r + s, p(1). */
+    CHECK(word_at(trace, "p", 0) < word_at(trace, "println", 0));
+    CHECK(word_at(trace, "println", 0) < first_p);
+    if (test_failures) {
+        fprintf(stderr, "trace: %s\n", trace);
+    }
+
+    test_unit_free(&t);
+    return test_report("test_inline");
+}
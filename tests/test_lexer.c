@@ -0,0 +1,212 @@
+/*
+ * Lexer edge cases: identifier characters, escapes, surrogate pairs and
+ * malformed UTF-8. make test builds it twice, once with the SSE2 string
+ * scan and once with -DLEXER_NO_SIMD for the word-at-a-time one.
+ */
+#include "test.h"
+#include "../src/common/lexer.h"
+
+#define MAX_TOKENS 16
+
+typedef struct {
+    Diag parent;
+    Diag diag;
+    Arena arena;
+    Token toks[MAX_TOKENS];
+    int count;
+    char messages[256];
+} Lexed;
+
+/* Lexes src up to EOF or the first error; the tokens' text points into src or the arena. */
+static void lex(Lexed *l, const char *src, size_t len) {
+    diag_init(&l->parent, "Lex.java", src, len);
+    diag_init_buffered(&l->diag, &l->parent);
+    arena_init(&l->arena);
+    Lexer lx;
+    lexer_init(&lx, src, len, &l->diag);
+    lx.arena = &l->arena;
+    l->count = 0;
+    for (;;) {
+        Token t = lexer_next(&lx);
+        if (t.type == TOK_EOF || l->count == MAX_TOKENS) break;
+        l->toks[l->count++] = t;
+    }
+    lexer_free(&lx);
+    test_diag_messages(&l->diag, l->messages, sizeof(l->messages));
+}
+
+static void lexed_free(Lexed *l) {
+    diag_free(&l->diag);
+    diag_free(&l->parent);
+    arena_free(&l->arena);
+}
+
+static int tok_is(const Token *t, TokenType type, const char *text) {
+    return t->type == type && t->len == strlen(text) && memcmp(t->start, text, t->len) == 0;
+}
+
+/* src must lex to exactly one identifier spelled (after decoding) as text. */
+static int one_ident(const char *src, const char *text) {
+    Lexed l;
+    lex(&l, src, strlen(src));
+    int ok = !l.diag.had_error && l.count == 1 && tok_is(&l.toks[0], TOK_IDENT, text);
+    lexed_free(&l);
+    return ok;
+}
+
+/* src must stop with an error containing message. */
+static int fails(const char *src, size_t len, const char *message) {
+    Lexed l;
+    lex(&l, src, len);
+    int ok = l.diag.had_error && strstr(l.messages, message) != NULL;
+    lexed_free(&l);
+    return ok;
+}
+
+static void test_ident_chars(void) {
+    CHECK(one_ident("\xcf\x80", "\xcf\x80"));                   /* π */
+    CHECK(one_ident("na\xc3\xafve", "na\xc3\xafve"));           /* naïve */
+    CHECK(one_ident("\xe6\x97\xa5\xe6\x9c\xac", "\xe6\x97\xa5\xe6\x9c\xac")); /* 日本 */
+    CHECK(one_ident("\xe2\x82\xac" "uro", "\xe2\x82\xac" "uro")); /* € is a currency sign */
+    CHECK(one_ident("\xc2\xa3x", "\xc2\xa3x"));                 /* £ too */
+    CHECK(one_ident("a\xe2\x80\xbf" "b", "a\xe2\x80\xbf" "b")); /* ‿ is a connector */
+    CHECK(one_ident("\xef\xb9\x8dx", "\xef\xb9\x8dx"));         /* ﹍ too */
+    CHECK(one_ident("x\xe2\x85\xa0", "x\xe2\x85\xa0"));         /* Ⅰ is a letter number */
+    CHECK(one_ident("\xf0\x9d\x91\xa5", "\xf0\x9d\x91\xa5"));   /* 𝑥, outside the BMP */
+
+    /* int a≠b = 3; is not one identifier. */
+    Lexed l;
+    const char *src = "int a\xe2\x89\xa0" "b = 3;";
+    lex(&l, src, strlen(src));
+    CHECK(l.count == 2);
+    CHECK(tok_is(&l.toks[0], TOK_KW_INT, "int"));
+    CHECK(tok_is(&l.toks[1], TOK_IDENT, "a"));
+    CHECK(strstr(l.messages, "unexpected character U+2260") != NULL);
+    lexed_free(&l);
+
+    CHECK(fails("a\xe2\x80\x94" "b", 5, "U+2014"));       /* em dash */
+    CHECK(fails("a\xe3\x80\x80" "b", 5, "U+3000"));       /* ideographic space */
+    CHECK(fails("a\xe3\x80\x81" "b", 5, "U+3001"));       /* ideographic comma */
+    CHECK(fails("a\xef\xbc\x8c" "b", 5, "U+FF0C"));       /* fullwidth comma */
+    CHECK(fails("a\xef\xb8\xb0" "b", 5, "U+FE30"));       /* vertical two-dot leader */
+    CHECK(fails("\xe2\x86\x92", 3, "U+2192"));            /* arrow */
+    CHECK(fails("\xc3\x97", 2, "U+00D7"));                /* multiplication sign */
+    CHECK(fails("\xf0\x9f\x98\x80", 4, "U+1F600"));       /* emoji */
+    CHECK(fails("\xc2\xad" "a", 3, "U+00AD"));            /* soft hyphen can't start one */
+    CHECK(one_ident("a\xc2\xad" "b", "a\xc2\xad" "b"));  /* ...but is ignored inside */
+}
+
+static void test_escapes(void) {
+    /* \u escapes in identifiers are decoded, so keywords still match. */
+    CHECK(one_ident("\\u0061bc", "abc"));
+    CHECK(one_ident("caf\\u00e9", "caf\xc3\xa9"));
+    CHECK(one_ident("\\uuu0078", "x"));
+    Lexed l;
+    lex(&l, "\\u0069nt", 8);
+    CHECK(l.count == 1 && l.toks[0].type == TOK_KW_INT);
+    lexed_free(&l);
+    CHECK(fails("a\\u2260b", 8, "U+2260"));
+
+    /* String escapes, including octal and a surrogate pair that becomes one 4-byte sequence. */
+    const char *src = "\"t\\tq\\\"b\\\\ \\101\\0\\377\\s \\uD83D\\uDE00\"";
+    lex(&l, src, strlen(src));
+    const char decoded[] = "\"t\tq\"b\\ A\0\xc3\xbf  \xf0\x9f\x98\x80\"";
+    CHECK(l.count == 1 && l.toks[0].type == TOK_STRING_LIT);
+    CHECK(l.toks[0].len == sizeof(decoded) - 1 && memcmp(l.toks[0].start, decoded, l.toks[0].len) == 0);
+    lexed_free(&l);
+
+    /* A lone surrogate escape is kept as its three-byte form. */
+    src = "\"\\uD83Dx\"";
+    lex(&l, src, strlen(src));
+    CHECK(l.count == 1 && tok_is(&l.toks[0], TOK_STRING_LIT, "\"\xed\xa0\xbdx\""));
+    lexed_free(&l);
+
+    CHECK(fails("\"\\q\"", 4, "invalid escape sequence"));
+    CHECK(fails("\"\\u12\"", 6, "invalid escape sequence"));
+}
+
+static void test_malformed_utf8(void) {
+    static const struct {
+        const char *bytes;
+        size_t len;
+    } bad[] = {
+        {"\x80", 1},             /* lone continuation byte */
+        {"\xc0\x80", 2},         /* overlong NUL */
+        {"\xe0\x80\xaf", 3},     /* overlong '/' */
+        {"\xe2\x82", 2},         /* truncated */
+        {"\xed\xa0\x80", 3},     /* encoded surrogate */
+        {"\xf4\x90\x80\x80", 4}, /* above U+10FFFF */
+        {"\xff", 1},
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char src[16];
+        /* As an identifier start, inside an identifier and inside a string. */
+        memcpy(src, bad[i].bytes, bad[i].len);
+        CHECK(fails(src, bad[i].len, "invalid UTF-8 sequence"));
+        src[0] = '"';
+        memcpy(src + 1, bad[i].bytes, bad[i].len);
+        src[bad[i].len + 1] = '"';
+        CHECK(fails(src, bad[i].len + 2, "invalid UTF-8 sequence"));
+
+        Lexed l;
+        src[0] = 'a';
+        memcpy(src + 1, bad[i].bytes, bad[i].len);
+        lex(&l, src, bad[i].len + 1);
+        CHECK(l.count >= 1 && tok_is(&l.toks[0], TOK_IDENT, "a"));
+        CHECK(strstr(l.messages, "invalid UTF-8 sequence") != NULL);
+        lexed_free(&l);
+    }
+}
+
+/*
+ * Puts one byte the string scan has to stop at at every offset across
+ * a few 16- and 8-byte blocks, so both block loops and their tails see it.
+ */
+static void test_string_scan(void) {
+    static const struct {
+        const char *insert;
+        const char *decoded;
+    } stops[] = {
+        {"\xc3\xa9", "\xc3\xa9"},
+        {"\\n", "\n"},
+        {"\\\"", "\""},
+    };
+    char src[128];
+    char want[128];
+    for (size_t s = 0; s < sizeof(stops) / sizeof(stops[0]); s++) {
+        for (size_t k = 0; k <= 40; k++) {
+            int n = snprintf(src, sizeof(src), "\"%.*s%s%.*s\";", (int)k,
+                             "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz", stops[s].insert,
+                             (int)(40 - k), "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ");
+            int w = snprintf(want, sizeof(want), "\"%.*s%s%.*s\"", (int)k,
+                             "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz", stops[s].decoded,
+                             (int)(40 - k), "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ");
+            Lexed l;
+            lex(&l, src, (size_t)n);
+            CHECK(!l.diag.had_error && l.count == 2);
+            CHECK(l.toks[0].type == TOK_STRING_LIT && l.toks[0].len == (size_t)w &&
+                  memcmp(l.toks[0].start, want, (size_t)w) == 0);
+            CHECK(l.toks[1].type == TOK_SEMI);
+            lexed_free(&l);
+        }
+    }
+
+    /* A newline or the end of input inside a string, at every offset. */
+    for (size_t k = 0; k <= 40; k++) {
+        int n = snprintf(src, sizeof(src), "\"%.*s\n\"", (int)k, "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+        CHECK(fails(src, (size_t)n, "unterminated string literal"));
+        CHECK(fails(src, k + 1, "unterminated string literal"));
+    }
+}
+
+int main(void) {
+    test_ident_chars();
+    test_escapes();
+    test_malformed_utf8();
+    test_string_scan();
+#ifdef LEXER_NO_SIMD
+    return test_report("test_lexer (no SIMD)");
+#else
+    return test_report("test_lexer");
+#endif
+}
@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+
+#include "test.h"
+#include "../src/common/pipeline.h"
+#include "../src/common/symbols.h"
+
+static const char *two_methods =
+    "public class Two {\n"
+    "    static int total;\n"
+    "    static int twice(int x) {\n"
+    "        return x * 2;\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        System.out.println(twice(21));\n"
+    "    }\n"
+    "}\n";
+
+typedef struct {
+    char names[8][32];
+    int members;
+    int classes;
+    int fields_at_end;
+} Seen;
+
+static void on_member(Ast *clazz, Ast *member, void *user) {
+    (void)clazz;
+    Seen *seen = (Seen *)user;
+    Str name = member->kind == AST_METHOD ? member->as.method_decl.name : member->as.field_decl.name;
+    if (seen->members < 8) {
+        snprintf(seen->names[seen->members], sizeof(seen->names[0]), "%.*s", (int)name.len, name.data);
+    }
+    seen->members++;
+}
+
+static void on_class(Ast *clazz, void *user) {
+    Seen *seen = (Seen *)user;
+    seen->classes++;
+    for (Ast *m = clazz->as.class_decl.members; m; m = m->next) {
+        CHECK(m->kind == AST_FIELD);
+        seen->fields_at_end++;
+    }
+}
+
+static int open_source(const char *src) {
+    char path[] = "/tmp/tinyjvm_pipeline.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    size_t len = strlen(src);
+    if (write(fd, src, len) != (ssize_t)len || lseek(fd, 0, SEEK_SET) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Streams a file whose main calls a method that has already been released,
+ * with the index from a streamed declarations pass over the same file.
+ */
+static void test_streams_two_methods(void) {
+    size_t len = strlen(two_methods);
+    Diag diag;
+    diag_init(&diag, "Two.java", two_methods, len);
+    int fd = open_source(two_methods);
+    CHECK(fd >= 0);
+    Arena decl_arena;
+    arena_init(&decl_arena);
+    SymbolIndex ix;
+    symbols_init(&ix);
+    CHECK(symbols_scan_fd(&ix, "Two.java", fd, &decl_arena, &diag));
+    CHECK(ix.main_class != NULL);
+    CHECK(lseek(fd, 0, SEEK_SET) == 0);
+
+    Arena arena;
+    arena_init(&arena);
+    Parser ps;
+    parser_init_fd(&ps, fd, &diag, &arena);
+    Seen seen;
+    memset(&seen, 0, sizeof(seen));
+    PipelineHooks hooks = {NULL, on_member, on_class, &seen, &ix};
+    CHECK(pipeline_compile(&ps, &diag, &hooks));
+    CHECK(!diag.had_error);
+    CHECK(seen.members == 3);
+    CHECK(strcmp(seen.names[0], "total") == 0);
+    CHECK(strcmp(seen.names[1], "twice") == 0);
+    CHECK(strcmp(seen.names[2], "main") == 0);
+    CHECK(seen.classes == 1);
+    CHECK(seen.fields_at_end == 1);
+
+    parser_free(&ps);
+    close(fd);
+    arena_free(&arena);
+    symbols_free(&ix);
+    arena_free(&decl_arena);
+    diag_free(&diag);
+}
+
+/* The streamed declarations pass keeps names, not bodies. */
+static void test_scan_drops_bodies(void) {
+    static char src[64 * 1024];
+    size_t len = (size_t)snprintf(src, sizeof(src), "class Big {\n    static int f(int x) {\n");
+    while (len < sizeof(src) - 64) {
+        len += (size_t)snprintf(src + len, sizeof(src) - len, "        x = x + y123456789;\n");
+    }
+    len += (size_t)snprintf(src + len, sizeof(src) - len, "        return x;\n    }\n}\n");
+    Diag diag;
+    diag_init(&diag, "Big.java", src, len);
+    int fd = open_source(src);
+    CHECK(fd >= 0);
+    Arena arena;
+    arena_init(&arena);
+    SymbolIndex ix;
+    symbols_init(&ix);
+    CHECK(symbols_scan_fd(&ix, "Big.java", fd, &arena, &diag));
+    Str big = {"Big", 3};
+    Str f = {"f", 1};
+    Ast *method = symbols_find_method(&ix, big, f);
+    CHECK(method && method->as.method_decl.params && method->as.method_decl.body == NULL);
+    CHECK(str_eq_c(method->as.method_decl.params->as.var_decl.name, "x"));
+    ArenaStats stats;
+    arena_stats(&arena, &stats);
+    CHECK(stats.used < 4096);
+    close(fd);
+    symbols_free(&ix);
+    arena_free(&arena);
+    diag_free(&diag);
+}
+
+static void test_requires_index(void) {
+    size_t len = strlen(two_methods);
+    Diag parent;
+    Diag diag;
+    diag_init(&parent, "Two.java", two_methods, len);
+    diag_init_buffered(&diag, &parent);
+    Arena arena;
+    arena_init(&arena);
+    Parser ps;
+    parser_init(&ps, two_methods, len, &diag, &arena);
+    Seen seen;
+    memset(&seen, 0, sizeof(seen));
+    PipelineHooks hooks = {NULL, on_member, on_class, &seen, NULL};
+    CHECK(!pipeline_compile(&ps, &diag, &hooks));
+    CHECK(diag.error_count == 1);
+    CHECK(seen.members == 0);
+    parser_free(&ps);
+    arena_free(&arena);
+    diag_free(&diag);
+    diag_free(&parent);
+}
+
+int main(void) {
+    test_streams_two_methods();
+    test_scan_drops_bodies();
+    test_requires_index();
+    return test_report("test_pipeline");
+}
@@ -0,0 +1,214 @@
+#include "test.h"
+#include "../src/common/stats.h"
+
+/* y is undeclared, so checking reports exactly one error. */
+static const char *src =
+    "class S {\n"
+    "    static int f(int x) {\n"
+    "        int z = x + 1;\n"
+    "        return y;\n"
+    "    }\n"
+    "}\n";
+
+/* class S { static int f ( int x ) { int z = x + 1 ; return y ; } } */
+#define SRC_TOKENS 23
+
+typedef struct {
+    const char *p;
+    const char *end;
+} Json;
+
+static void json_ws(Json *j) {
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\n' || *j->p == '\t' || *j->p == '\r')) j->p++;
+}
+
+static int json_lit(Json *j, const char *word) {
+    size_t n = strlen(word);
+    if ((size_t)(j->end - j->p) < n || memcmp(j->p, word, n) != 0) return 0;
+    j->p += n;
+    return 1;
+}
+
+/* Strings without escapes are all stats_print writes. */
+static int json_string(Json *j) {
+    if (j->p >= j->end || *j->p != '"') return 0;
+    for (j->p++; j->p < j->end && *j->p != '"'; j->p++) {
+        if (*j->p == '\\' || (unsigned char)*j->p < 0x20) return 0;
+    }
+    return j->p++ < j->end;
+}
+
+static int json_number(Json *j) {
+    const char *start = j->p;
+    if (j->p < j->end && *j->p == '-') j->p++;
+    while (j->p < j->end && *j->p >= '0' && *j->p <= '9') j->p++;
+    if (j->p < j->end && *j->p == '.') {
+        j->p++;
+        while (j->p < j->end && *j->p >= '0' && *j->p <= '9') j->p++;
+    }
+    return j->p > start && j->p[-1] >= '0' && j->p[-1] <= '9';
+}
+
+static int json_value(Json *j);
+
+static int json_object(Json *j) {
+    j->p++;
+    json_ws(j);
+    if (j->p < j->end && *j->p == '}') {
+        j->p++;
+        return 1;
+    }
+    for (;;) {
+        json_ws(j);
+        if (!json_string(j)) return 0;
+        json_ws(j);
+        if (!json_lit(j, ":") || !json_value(j)) return 0;
+        json_ws(j);
+        if (json_lit(j, "}")) return 1;
+        if (!json_lit(j, ",")) return 0;
+    }
+}
+
+static int json_value(Json *j) {
+    json_ws(j);
+    if (j->p >= j->end) return 0;
+    if (*j->p == '{') return json_object(j);
+    if (*j->p == '"') return json_string(j);
+    return json_lit(j, "true") || json_lit(j, "false") || json_lit(j, "null") || json_number(j);
+}
+
+static int is_json(const char *text) {
+    Json j = {text, text + strlen(text)};
+    if (!json_value(&j)) return 0;
+    json_ws(&j);
+    return j.p == j.end;
+}
+
+/* What stats_print writes, as a string. */
+static void print_to(const CompileStats *st, char *buf, size_t cap) {
+    FILE *f = tmpfile();
+    buf[0] = '\0';
+    if (!f) return;
+    stats_print(st, f);
+    rewind(f);
+    size_t n = fread(buf, 1, cap - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+}
+
+static void test_flags(void) {
+    CompileStats st;
+    stats_init(&st);
+    CHECK(st.mode == STATS_OFF);
+    CHECK(stats_parse_flag(&st, "-Xtime") && st.mode == STATS_TEXT);
+    CHECK(stats_parse_flag(&st, "-Xstats=json") && st.mode == STATS_JSON);
+
+    static const char *const others[] = {"-Xstats", "-Xstats=text", "-Xtimes", "-xtime", "Xtime", "-X", ""};
+    for (size_t i = 0; i < sizeof(others) / sizeof(others[0]); i++) {
+        stats_init(&st);
+        CHECK(!stats_parse_flag(&st, others[i]));
+        CHECK(st.mode == STATS_OFF);
+    }
+
+    /* Off, phases are not timed and nothing is printed. */
+    stats_init(&st);
+    stats_begin(&st, PHASE_PARSE);
+    stats_end(&st, PHASE_PARSE);
+    CHECK(st.phases[PHASE_PARSE].wall_start == 0.0 && st.phases[PHASE_PARSE].wall == 0.0);
+    char out[64];
+    print_to(&st, out, sizeof(out));
+    CHECK(out[0] == '\0');
+}
+
+static void test_collect_and_print(void) {
+    CompileStats st;
+    stats_init(&st);
+    CHECK(stats_parse_flag(&st, "-Xtime"));
+
+    size_t len = strlen(src);
+    Diag parent;
+    Diag diag;
+    diag_init(&parent, "S.java", src, len);
+    diag_init_buffered(&diag, &parent);
+    Arena arena;
+    arena_init(&arena);
+    Parser ps;
+    stats_begin(&st, PHASE_PARSE);
+    parser_init(&ps, src, len, &diag, &arena);
+    Ast *unit = parse_compilation_unit(&ps);
+    stats_end(&st, PHASE_PARSE);
+    stats_begin(&st, PHASE_TYPE_CHECK);
+    Ast *clazz = unit->as.comp_unit.clazz;
+    CHECK(!type_check_member(clazz, clazz->as.class_decl.members, NULL, &diag));
+    stats_end(&st, PHASE_TYPE_CHECK);
+    stats_collect(&st, &ps, &diag);
+    parser_free(&ps);
+
+    CHECK(st.phases[PHASE_PARSE].wall >= 0.0 && st.phases[PHASE_PARSE].cpu >= 0.0);
+    CHECK(st.phases[PHASE_TYPE_CHECK].wall >= 0.0);
+    CHECK(st.phases[PHASE_EMIT].wall == 0.0);
+    CHECK(st.input_bytes == len);
+    CHECK(st.tokens == SRC_TOKENS);
+    CHECK(st.diagnostics == 1);
+
+    size_t want[AST_KIND_COUNT] = {0};
+    want[AST_COMP_UNIT] = 1;
+    want[AST_CLASS] = 1;
+    want[AST_METHOD] = 1;
+    want[AST_VAR_DECL] = 2;
+    want[AST_BLOCK] = 1;
+    want[AST_RETURN] = 1;
+    want[AST_BIN] = 1;
+    want[AST_INT_LIT] = 1;
+    want[AST_IDENT] = 2;
+    for (int i = 0; i < AST_KIND_COUNT; i++) {
+        CHECK(st.nodes[i] == want[i]);
+    }
+
+    ArenaStats as;
+    arena_stats(&arena, &as);
+    CHECK(st.arena.chunks == as.chunks && st.arena.reserved == as.reserved && st.arena.used == as.used);
+    CHECK(st.arena.chunks >= 1 && st.arena.used > 0 && st.arena.used <= st.arena.reserved);
+
+    char out[2048];
+    char line[128];
+    print_to(&st, out, sizeof(out));
+    CHECK(strncmp(out, "phase", 5) == 0);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        snprintf(line, sizeof(line), "\n%-12s ", stats_phase_name((Phase)i));
+        CHECK(strstr(out, line) != NULL);
+    }
+    CHECK(strstr(out, "\ntotal ") != NULL);
+    snprintf(line, sizeof(line), "input: %zu bytes, %d tokens\n", len, SRC_TOKENS);
+    CHECK(strstr(out, line) != NULL);
+    CHECK(strstr(out, "ast nodes: COMP_UNIT=1 CLASS=1 METHOD=1 BLOCK=1 RETURN=1 VAR_DECL=2 BIN=1 INT_LIT=1 IDENT=2\n") != NULL);
+    snprintf(line, sizeof(line), "arena: %zu chunks, %zu bytes reserved, %zu bytes used\n", as.chunks, as.reserved,
+             as.used);
+    CHECK(strstr(out, line) != NULL);
+    CHECK(strstr(out, "diagnostics: 1\n") != NULL);
+
+    CHECK(stats_parse_flag(&st, "-Xstats=json"));
+    print_to(&st, out, sizeof(out));
+    CHECK(is_json(out));
+    CHECK(strstr(out, "\"parse\": {\"wall_ms\": ") != NULL);
+    snprintf(line, sizeof(line), "\"input_bytes\": %zu, \"tokens\": %d,", len, SRC_TOKENS);
+    CHECK(strstr(out, line) != NULL);
+    CHECK(strstr(out, "\"nodes\": {\"COMP_UNIT\": 1, \"CLASS\": 1, \"METHOD\": 1, \"BLOCK\": 1, \"RETURN\": 1, "
+                      "\"VAR_DECL\": 2, \"BIN\": 1, \"INT_LIT\": 1, \"IDENT\": 2}") != NULL);
+    CHECK(strstr(out, "\"diagnostics\": 1}") != NULL);
+
+    /* The validator itself rejects what a broken printer might write. */
+    CHECK(!is_json("{\"a\": 1,}"));
+    CHECK(!is_json("{\"a\": 1} x"));
+    CHECK(!is_json("{\"a\" 1}"));
+
+    diag_free(&diag);
+    diag_free(&parent);
+    arena_free(&arena);
+}
+
+int main(void) {
+    test_flags();
+    test_collect_and_print();
+    return test_report("test_stats");
+}
@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Streaming input: built with a tiny LEXER_CHUNK, so that tokens, comments
+ * and escapes straddle refills, and compared against in-memory lexing and
+ * parsing of the same source.
+ */
+#include <unistd.h>
+
+#include "test.h"
+#include "../src/common/lexer.h"
+
+#ifndef LEXER_CHUNK
+#error "build with -DLEXER_CHUNK=<small size>, as make test does"
+#endif
+
+static const char *sources[] = {
+    "public class Stream {\n"
+    "    // a line comment that is longer than one chunk\n"
+    "    static int accumulate(int count, int step) {\n"
+    "        int total = 0;\n"
+    "        /* block comment\n"
+    "           spanning lines */\n"
+    "        for (int index = 0; index <= count; index++) {\n"
+    "            total = total + index * step % 1000003;\n"
+    "        }\n"
+    "        return total;\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        System.out.println(\"a string literal that spans several chunks\");\n"
+    "        System.out.println(accumulate(123456789, 7));\n"
+    "    }\n"
+    "}\n",
+
+    "public class Esc {\n"
+    "    public static void main(String[] args) {\n"
+    "        int caf\\u00e9 = 1;\n"
+    "        int \xc3\xa9t\xc3\xa9 = caf\xc3\xa9 + 2;\n"
+    "        System.out.println(\"tab\\there \\u0041\\uD83D\\uDE00 \\\"quoted\\\" \\101\");\n"
+    "        System.out.println(\xc3\xa9t\xc3\xa9);\n"
+    "    }\n"
+    "}\n",
+};
+
+static int write_temp(const char *text, size_t len) {
+    char path[] = "/tmp/tinyjvm_stream.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    if (write(fd, text, len) != (ssize_t)len || lseek(fd, 0, SEEK_SET) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void check_tokens(const char *src, size_t len) {
+    int fd = write_temp(src, len);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    Diag mem_diag;
+    Diag fd_diag;
+    diag_init(&mem_diag, "mem", src, len);
+    diag_init(&fd_diag, "fd", NULL, 0);
+    Arena mem_arena;
+    Arena fd_arena;
+    arena_init(&mem_arena);
+    arena_init(&fd_arena);
+    Lexer mem;
+    Lexer stream;
+    lexer_init(&mem, src, len, &mem_diag);
+    mem.arena = &mem_arena;
+    lexer_init_fd(&stream, fd, &fd_diag, &fd_arena);
+    for (;;) {
+        Token a = lexer_next(&mem);
+        Token b = lexer_next(&stream);
+        CHECK(a.type == b.type);
+        CHECK(a.pos == b.pos);
+        CHECK(a.len == b.len && memcmp(a.start, b.start, a.len) == 0);
+        if (a.type != b.type || a.type == TOK_EOF) {
+            break;
+        }
+    }
+    CHECK(mem.token_count == stream.token_count);
+    CHECK(!mem_diag.had_error && !fd_diag.had_error);
+    lexer_free(&stream);
+    lexer_free(&mem);
+    arena_free(&fd_arena);
+    arena_free(&mem_arena);
+    diag_free(&fd_diag);
+    diag_free(&mem_diag);
+    close(fd);
+}
+
+static void check_parse(const char *src, size_t len) {
+    int fd = write_temp(src, len);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    Diag mem_diag;
+    Diag fd_diag;
+    diag_init(&mem_diag, "mem", src, len);
+    diag_init(&fd_diag, "fd", NULL, 0);
+    Arena mem_arena;
+    Arena fd_arena;
+    arena_init(&mem_arena);
+    arena_init(&fd_arena);
+    Parser mem;
+    Parser stream;
+    parser_init(&mem, src, len, &mem_diag, &mem_arena);
+    parser_init_fd(&stream, fd, &fd_diag, &fd_arena);
+    Ast *a = parse_compilation_unit(&mem);
+    Ast *b = parse_compilation_unit(&stream);
+    CHECK(a && b);
+    CHECK(memcmp(mem.node_counts, stream.node_counts, sizeof(mem.node_counts)) == 0);
+    CHECK(!mem_diag.had_error && !fd_diag.had_error);
+    if (a && b) {
+        CHECK(type_check_comp_unit(a, &mem_diag));
+        CHECK(type_check_comp_unit(b, &fd_diag));
+    }
+    parser_free(&stream);
+    parser_free(&mem);
+    arena_free(&fd_arena);
+    arena_free(&mem_arena);
+    diag_free(&fd_diag);
+    diag_free(&mem_diag);
+    close(fd);
+}
+
+/* Errors found while streaming report the same line and column as in memory. */
+static void check_error_position(void) {
+    const char *src = "public class E {\n    public static void main(String[] args) {\n        int x = 1 +;\n    }\n}\n";
+    int fd = write_temp(src, strlen(src));
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    Diag parent;
+    Diag diag;
+    diag_init(&parent, "E.java", NULL, 0);
+    diag_init_buffered(&diag, &parent);
+    Arena arena;
+    arena_init(&arena);
+    Parser ps;
+    parser_init_fd(&ps, fd, &diag, &arena);
+    parse_compilation_unit(&ps);
+    CHECK(diag.had_error);
+    const char *expect = "E.java:3:20: error:";
+    CHECK(diag.buf_len > strlen(expect) && memcmp(diag.buf, expect, strlen(expect)) == 0);
+    parser_free(&ps);
+    arena_free(&arena);
+    diag_free(&diag);
+    diag_free(&parent);
+    close(fd);
+}
+
+int main(void) {
+    char shifted[4096];
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        size_t len = strlen(sources[i]);
+        /* Leading blanks move every token across each position in a chunk. */
+        for (size_t pad = 0; pad <= LEXER_CHUNK; pad++) {
+            memset(shifted, ' ', pad);
+            memcpy(shifted + pad, sources[i], len + 1);
+            check_tokens(shifted, pad + len);
+            check_parse(shifted, pad + len);
+        }
+    }
+    check_error_position();
+    return test_report("test_stream");
+}
@@ -0,0 +1,181 @@
+#include "test.h"
+#include "../src/common/symbols.h"
+
+static const char *owner_src =
+    "class Owner {\n"
+    "    static int foo(int x) {\n"
+    "        return x + bar();\n"
+    "    }\n"
+    "    static int bar() {\n"
+    "        return 1;\n"
+    "    }\n"
+    "    static Owner make() {\n"
+    "        Owner o = new Owner();\n"
+    "        return o;\n"
+    "    }\n"
+    "}\n";
+
+static const char *main_src =
+    "public class Main {\n"
+    "    static int use(Owner o, int x) {\n"
+    "        return Owner.foo(x);\n"
+    "    }\n"
+    "    public static void main(String[] args) {\n"
+    "        Owner o = new Owner();\n"
+    "        Owner p = Owner.make();\n"
+    "        p = o;\n"
+    "        System.out.println(use(p, 2));\n"
+    "    }\n"
+    "}\n";
+
+/* A project of in-memory files indexed by one declarations pass. */
+typedef struct {
+    Diag parents[4];
+    Diag diags[4];
+    Arena arena;
+    SymbolIndex ix;
+    int count;
+} Project;
+
+static int project_add(Project *p, const char *path, const char *src) {
+    int i = p->count++;
+    diag_init(&p->parents[i], path, src, strlen(src));
+    diag_init_buffered(&p->diags[i], &p->parents[i]);
+    return symbols_scan_file(&p->ix, path, src, strlen(src), &p->arena, &p->diags[i]);
+}
+
+static void project_init(Project *p) {
+    p->count = 0;
+    arena_init(&p->arena);
+    symbols_init(&p->ix);
+}
+
+static void project_free(Project *p) {
+    for (int i = 0; i < p->count; i++) {
+        diag_free(&p->diags[i]);
+        diag_free(&p->parents[i]);
+    }
+    symbols_free(&p->ix);
+    arena_free(&p->arena);
+}
+
+/* Parses and checks src against the project index; returns the diagnostics, or "" if it checked. */
+static const char *check_in(Project *p, const char *src, char *messages, size_t cap) {
+    Diag parent;
+    Diag diag;
+    Arena arena;
+    diag_init(&parent, "Check.java", src, strlen(src));
+    diag_init_buffered(&diag, &parent);
+    arena_init(&arena);
+    Parser ps;
+    parser_init(&ps, src, strlen(src), &diag, &arena);
+    Ast *unit = parse_compilation_unit(&ps);
+    parser_free(&ps);
+    TypeCheckOptions opts = {0};
+    opts.threads = 1;
+    opts.symbols = &p->ix;
+    if (unit && !diag.had_error) {
+        type_check_comp_unit_opts(unit, &diag, &opts);
+    }
+    test_diag_messages(&diag, messages, cap);
+    diag_free(&diag);
+    diag_free(&parent);
+    arena_free(&arena);
+    return messages;
+}
+
+static void test_cross_file(void) {
+    Project p;
+    project_init(&p);
+    CHECK(project_add(&p, "Owner.java", owner_src));
+    CHECK(project_add(&p, "Main.java", main_src));
+    CHECK(p.ix.main_class && str_eq_c(p.ix.main_class->as.class_decl.name, "Main"));
+
+    Str owner = {"Owner", 5};
+    Str main_name = {"Main", 4};
+    Str foo = {"foo", 3};
+    Str qualified = {"Owner.foo", 9};
+    Str missing = {"Owner.baz", 9};
+    CHECK(symbols_find_method(&p.ix, owner, foo) != NULL);
+    CHECK(symbols_find_method(&p.ix, main_name, qualified) == symbols_find_method(&p.ix, owner, foo));
+    CHECK(symbols_find_method(&p.ix, main_name, foo) == NULL);
+    CHECK(symbols_find_method(&p.ix, main_name, missing) == NULL);
+
+    /* Owner.foo() and the Owner type resolve from Main's file, and bar() within Owner's. */
+    char messages[512];
+    CHECK(strcmp(check_in(&p, main_src, messages, sizeof(messages)), "") == 0);
+    CHECK(strcmp(check_in(&p, owner_src, messages, sizeof(messages)), "") == 0);
+
+    /* Class types are told apart. */
+    const char *mixed =
+        "class Main {\n"
+        "    static int f(Owner o) {\n"
+        "        Main m = o;\n"
+        "        Owner q = new Main();\n"
+        "        return use(m, 1);\n"
+        "    }\n"
+        "}\n";
+    check_in(&p, mixed, messages, sizeof(messages));
+    CHECK(strstr(messages, "type mismatch: 'Owner' cannot be assigned to 'Main'") != NULL);
+    CHECK(strstr(messages, "type mismatch: 'Main' cannot be assigned to 'Owner'") != NULL);
+    CHECK(strstr(messages, "argument 1 of 'use' must be 'Owner', not 'Main'") != NULL);
+
+    const char *unknown =
+        "class Main {\n"
+        "    static int f(Nowhere n) {\n"
+        "        Elsewhere e = new Elsewhere();\n"
+        "        return Owner.baz(1);\n"
+        "    }\n"
+        "}\n";
+    check_in(&p, unknown, messages, sizeof(messages));
+    CHECK(strstr(messages, "unsupported parameter type 'Nowhere'") != NULL);
+    CHECK(strstr(messages, "unsupported local type 'Elsewhere'") != NULL);
+    CHECK(strstr(messages, "unknown method 'Owner.baz'") != NULL);
+    project_free(&p);
+}
+
+static int has_message(Diag *d, const char *message) {
+    char buf[512];
+    return strstr(test_diag_messages(d, buf, sizeof(buf)), message) != NULL;
+}
+
+static void test_duplicates(void) {
+    Project p;
+    project_init(&p);
+    CHECK(project_add(&p, "Owner.java", owner_src));
+    CHECK(!project_add(&p, "Copy.java", "class Owner {\n    static int foo(int x) {\n        return x;\n    }\n}\n"));
+    CHECK(has_message(&p.diags[1], "Copy.java:1:1: error: duplicate class 'Owner', first declared in Owner.java"));
+    CHECK(has_message(&p.diags[1], "duplicate method 'Owner.foo', first declared in Owner.java"));
+
+    /* Within one file, and for a field against a field. */
+    CHECK(!project_add(&p, "Twice.java",
+                       "class Twice {\n"
+                       "    int n;\n"
+                       "    int n;\n"
+                       "    static int g() {\n"
+                       "        return 1;\n"
+                       "    }\n"
+                       "    static int g() {\n"
+                       "        return 2;\n"
+                       "    }\n"
+                       "}\n"));
+    CHECK(has_message(&p.diags[2], "Twice.java:3:"));
+    CHECK(has_message(&p.diags[2], "duplicate field 'Twice.n', first declared in Twice.java"));
+    CHECK(has_message(&p.diags[2], "Twice.java:7:"));
+    CHECK(has_message(&p.diags[2], "duplicate method 'Twice.g', first declared in Twice.java"));
+
+    /* The first declarations stay in the index. */
+    Str owner = {"Owner", 5};
+    Str foo = {"foo", 3};
+    Ast *kept = symbols_find_method(&p.ix, owner, foo);
+    CHECK(kept && kept->as.method_decl.params && kept->as.method_decl.body == NULL);
+    const Symbol *s = symbols_find(&p.ix, SYM_METHOD, owner, foo);
+    CHECK(s && strcmp(s->path, "Owner.java") == 0);
+    project_free(&p);
+}
+
+int main(void) {
+    test_cross_file();
+    test_duplicates();
+    return test_report("test_symbols");
+}
@@ -0,0 +1,122 @@
+#include "test.h"
+
+/* Many methods, every third with two errors, so scheduling could reorder them. */
+static char *make_unit(int methods, size_t *out_len) {
+    size_t cap = (size_t)methods * 256 + 256;
+    char *src = (char *)malloc(cap);
+    if (!src) {
+        return NULL;
+    }
+    size_t len = (size_t)snprintf(src, cap, "public class Pool {\n    static int count;\n");
+    for (int i = 0; i < methods; i++) {
+        if (i % 3 == 0) {
+            len += (size_t)snprintf(src + len, cap - len,
+                                    "    static int m%d(int x) {\n        int y = \"s\";\n        return q%d(x);\n    }\n", i, i);
+        } else {
+            len += (size_t)snprintf(src + len, cap - len,
+                                    "    static int m%d(int x) {\n        int y = x * %d;\n        return y + m%d(x);\n    }\n", i, i,
+                                    (i + 1) % methods);
+        }
+    }
+    len += (size_t)snprintf(src + len, cap - len, "    public static void main(String[] args) {\n        System.out.println(m1(2));\n    }\n}\n");
+    *out_len = len;
+    return src;
+}
+
+typedef struct {
+    size_t merged[128];
+    size_t merge_count;
+    size_t emitted;
+    size_t alloc_failures; /* counted on the workers, checked after the join */
+} Calls;
+
+static void on_emit(Ast *method, size_t index, Arena *scratch, Diag *diag, void *user) {
+    (void)method;
+    (void)index;
+    (void)diag;
+    Calls *calls = (Calls *)user;
+    if (!arena_alloc(scratch, 64)) {
+        __atomic_fetch_add(&calls->alloc_failures, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&calls->emitted, 1, __ATOMIC_RELAXED);
+}
+
+static void on_merge(Ast *method, size_t index, void *user) {
+    (void)method;
+    Calls *calls = (Calls *)user;
+    if (calls->merge_count < 128) {
+        calls->merged[calls->merge_count++] = index;
+    }
+}
+
+/* Checks src with the given thread count; returns the diagnostics text. */
+static char *check_with(const char *src, size_t len, int threads, int *errors, Calls *calls) {
+    Diag parent;
+    Diag diag;
+    diag_init(&parent, "Pool.java", src, len);
+    diag_init_buffered(&diag, &parent);
+    Arena arena;
+    arena_init(&arena);
+    Parser ps;
+    parser_init(&ps, src, len, &diag, &arena);
+    Ast *unit = parse_compilation_unit(&ps);
+    parser_free(&ps);
+    CHECK(unit && !diag.had_error);
+
+    TypeCheckOptions opts = {0};
+    opts.threads = threads;
+    opts.emit_method = on_emit;
+    opts.merge_method = on_merge;
+    opts.user = calls;
+    CHECK(!type_check_comp_unit_opts(unit, &diag, &opts));
+
+    char *text = (char *)malloc(diag.buf_len + 1);
+    if (text) {
+        test_diag_messages(&diag, text, diag.buf_len + 1);
+    }
+    *errors = diag.error_count;
+    arena_free(&arena);
+    diag_free(&diag);
+    diag_free(&parent);
+    return text;
+}
+
+static void test_threads_match_single(void) {
+    const int methods = 96;
+    size_t len = 0;
+    char *src = make_unit(methods, &len);
+    CHECK(src != NULL);
+    if (!src) {
+        return;
+    }
+    Calls base = {{0}, 0, 0, 0};
+    int base_errors = 0;
+    char *expect = check_with(src, len, 1, &base_errors, &base);
+    CHECK(expect != NULL);
+    CHECK(base_errors == 2 * ((methods + 2) / 3));
+    CHECK(base.emitted == base.merge_count);
+    CHECK(base.alloc_failures == 0);
+    CHECK(base.merge_count == (size_t)(methods - (methods + 2) / 3 + 1));
+
+    for (int round = 0; round < 20 && expect; round++) {
+        Calls calls = {{0}, 0, 0, 0};
+        int errors = 0;
+        char *got = check_with(src, len, 2 + round % 7, &errors, &calls);
+        CHECK(got && strcmp(got, expect) == 0);
+        CHECK(errors == base_errors);
+        CHECK(calls.emitted == base.emitted);
+        CHECK(calls.alloc_failures == 0);
+        CHECK(calls.merge_count == base.merge_count);
+        CHECK(memcmp(calls.merged, base.merged, base.merge_count * sizeof(size_t)) == 0);
+        free(got);
+    }
+    /* Member order: the first diagnostics belong to m0. */
+    CHECK(expect && strstr(expect, "Pool.java:4:") == expect);
+    free(expect);
+    free(src);
+}
+
+int main(void) {
+    test_threads_match_single();
+    return test_report("test_type_check");
+}